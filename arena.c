@@ -0,0 +1,61 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "arena.h"
+
+// not cached, arenas are set up from several threads by the batch runner
+size_t pageSize(void) {
+    return sysconf(_SC_PAGESIZE);
+}
+
+size_t pageAlign(size_t bytes) {
+    size_t page = pageSize();
+    return (bytes + page - 1) / page * page;
+}
+
+void arenaInit(Arena* arena, size_t reserve_bytes) {
+    *arena = (Arena) {0};
+    arena->reserved = pageAlign(reserve_bytes);
+
+    void* base = mmap(NULL, arena->reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "arena: could not reserve %zu bytes\n", arena->reserved);
+        exit(1);
+    }
+    arena->base = base;
+}
+
+void* arenaReserve(Arena* arena, size_t bytes) {
+    bytes = pageAlign(bytes);
+    if (arena->used + bytes > arena->reserved) {
+        fprintf(stderr, "arena: out of address space (%zu of %zu bytes used)\n", arena->used, arena->reserved);
+        exit(1);
+    }
+
+    void* region = arena->base + arena->used;
+    arena->used += bytes;
+    return region;
+}
+
+void arenaCommit(Arena* arena, void* region, size_t from_bytes, size_t to_bytes) {
+    // whole pages, the one holding from_bytes is committed already when it is partly used
+    size_t from = pageAlign(from_bytes);
+    size_t to = pageAlign(to_bytes);
+    if (to <= from) { return; }
+
+    if (mprotect((char*) region + from, to - from, PROT_READ | PROT_WRITE) != 0) {
+        fprintf(stderr, "arena: could not commit %zu bytes\n", to - from);
+        exit(1);
+    }
+    arena->committed += to - from;
+    arena->commits++;
+}
+
+void arenaFree(Arena* arena) {
+    if (arena->base != NULL) {
+        munmap(arena->base, arena->reserved);
+    }
+    *arena = (Arena) {0};
+}
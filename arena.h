@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// address space is reserved once and backed by memory only as it is committed,
+// so what lives in the arena never moves and pointers into it stay valid
+typedef struct Arena {
+    char* base;
+    size_t reserved; // bytes of address space
+    size_t used; // bytes of address space handed out
+    size_t committed; // bytes backed by memory
+    int commits; // number of commit calls, i.e. growth events
+} Arena;
+
+// reserves the address space, nothing is committed yet
+void arenaInit(Arena* arena, size_t reserve_bytes);
+// hands out a page aligned region of the reserved space, commit it before use
+void* arenaReserve(Arena* arena, size_t bytes);
+// commits the part of a region between from_bytes and to_bytes
+void arenaCommit(Arena* arena, void* region, size_t from_bytes, size_t to_bytes);
+void arenaFree(Arena* arena);
+
+#endif
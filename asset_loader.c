@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include "asset_loader.h"
+#include "profiler.h"
+
+void* runAssetWorker(void* arg) {
+    AssetLoader* loader = arg;
+
+    while (true) {
+        pthread_mutex_lock(&loader->lock);
+        int sprite = loader->next_sprite < SPRITE_COUNT ? loader->next_sprite++ : -1;
+        pthread_mutex_unlock(&loader->lock);
+        if (sprite == -1) break;
+
+        Image image = loadSpriteImage(sprite);
+
+        pthread_mutex_lock(&loader->lock);
+        loader->decoded[sprite] = image;
+        loader->waiting[sprite] = true;
+        pthread_mutex_unlock(&loader->lock);
+    }
+    return NULL;
+}
+
+void startAssetLoader(AssetLoader* loader, Atlas* atlas, int thread_count) {
+    *loader = (AssetLoader) {.atlas=atlas, .started=profilerNow()};
+
+    if (loadAtlasBundle(atlas, ATLAS_BUNDLE)) {
+        loader->uploaded = SPRITE_COUNT;
+        TraceLog(LOG_INFO, "ATLAS: loaded %s in %.2f ms", ATLAS_BUNDLE, (profilerNow() - loader->started) * 1000);
+        return;
+    }
+
+    // every sprite goes to its own rectangle, the texture can be made before any of them is decoded
+    *atlas = blankAtlas();
+    if (thread_count > SPRITE_COUNT) thread_count = SPRITE_COUNT;
+    if (thread_count < 1) thread_count = 1;
+
+    pthread_mutex_init(&loader->lock, NULL);
+    loader->threads = malloc(thread_count * sizeof(pthread_t));
+    for (int t = 0; t < thread_count; t++) {
+        if (pthread_create(&loader->threads[t], NULL, runAssetWorker, loader) != 0) break;
+        loader->thread_count++;
+    }
+    // without any worker the sprites are decoded here, the loading screen then shows no progress
+    if (loader->thread_count == 0) {
+        runAssetWorker(loader);
+    }
+}
+
+bool updateAssetLoader(AssetLoader* loader) {
+    if (loader->uploaded == SPRITE_COUNT) return true;
+
+    Image ready[SPRITE_COUNT];
+    bool taken[SPRITE_COUNT] = {0};
+    pthread_mutex_lock(&loader->lock);
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        if (loader->waiting[s]) {
+            ready[s] = loader->decoded[s];
+            loader->waiting[s] = false;
+            taken[s] = true;
+        }
+    }
+    pthread_mutex_unlock(&loader->lock);
+
+    // the workers keep decoding while these go to the gpu
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        if (!taken[s]) { continue; }
+        // loadSpriteImage() has no pixels for a file that could not be read, its sprite stays blank
+        if (ready[s].data == NULL) {
+            TraceLog(LOG_WARNING, "ATLAS: could not decode %s, the sprite stays blank", SPRITE_SOURCES[s].filename);
+        } else {
+            uploadSprite(loader->atlas, s, ready[s]);
+            UnloadImage(ready[s]);
+        }
+        loader->uploaded++;
+    }
+
+    if (loader->uploaded == SPRITE_COUNT) {
+        TraceLog(LOG_INFO, "ATLAS: no usable %s, decoded the sprites on %d threads in %.2f ms",
+            ATLAS_BUNDLE, loader->thread_count, (profilerNow() - loader->started) * 1000);
+        return true;
+    }
+    return false;
+}
+
+float assetLoaderProgress(AssetLoader* loader) {
+    return (float) loader->uploaded / SPRITE_COUNT;
+}
+
+void stopAssetLoader(AssetLoader* loader) {
+    if (loader->threads == NULL) return;
+
+    // the workers finish the sprite they are on and take no other
+    pthread_mutex_lock(&loader->lock);
+    loader->next_sprite = SPRITE_COUNT;
+    pthread_mutex_unlock(&loader->lock);
+    for (int t = 0; t < loader->thread_count; t++) {
+        pthread_join(loader->threads[t], NULL);
+    }
+
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        if (loader->waiting[s]) {
+            UnloadImage(loader->decoded[s]);
+        }
+    }
+    pthread_mutex_destroy(&loader->lock);
+    free(loader->threads);
+    loader->threads = NULL;
+}
@@ -0,0 +1,32 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <pthread.h>
+#include "raylib.h"
+#include "atlas.h"
+
+// decodes the sprites on worker threads while the main thread keeps drawing frames.
+// gl only works on the thread that owns the context, so the workers hand back cpu side
+// images and updateAssetLoader() copies them into the atlas texture
+typedef struct AssetLoader {
+    Atlas* atlas;
+    pthread_t* threads;
+    int thread_count;
+    pthread_mutex_t lock; // of next_sprite, decoded and waiting
+    int next_sprite; // the next worker to ask decodes this one
+    Image decoded[SPRITE_COUNT];
+    bool waiting[SPRITE_COUNT]; // decoded and not uploaded yet
+    int uploaded;
+    double started;
+} AssetLoader;
+
+// uses ATLAS_BUNDLE right away when it is usable, the workers only start without one
+void startAssetLoader(AssetLoader* loader, Atlas* atlas, int thread_count);
+// uploads what was decoded since the last call, true once every sprite is in the atlas
+bool updateAssetLoader(AssetLoader* loader);
+// 0 to 1
+float assetLoaderProgress(AssetLoader* loader);
+// waits for the workers, also when they are not done. sprites not uploaded by then stay blank
+void stopAssetLoader(AssetLoader* loader);
+
+#endif
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "atlas.h"
+#include "profiler.h"
+
+// sprites are apart by this much so neighbours never bleed into each other
+#define ATLAS_PADDING 2
+#define ATLAS_WIDTH 512
+
+const SpriteSource SPRITE_SOURCES[SPRITE_COUNT] = {
+    [SPRITE_GROUND_GRASS] = {"Blocks/blocks_1.png", 64, 64},
+    [SPRITE_GROUND_PAVEMENT] = {"Blocks/blocks_56.png", 64, 64},
+    [SPRITE_GROUND_SAND] = {"Blocks/blocks_32.png", 64, 64},
+    [SPRITE_MOUSEOVER] = {"Blocks/blocks_99.png", 64, 64},
+    [SPRITE_FULL_OVERLAY] = {"Blocks/overlay.png", 64, 64},
+    [SPRITE_HALF_OVERLAY] = {"Blocks/half_overlay.png", 64, 64},
+    [SPRITE_ENEMY_TYPE_1] = {"Blocks/blocks_30.png", 64, 64},
+    [SPRITE_ENEMY_TYPE_2] = {"Blocks/blocks_31.png", 64, 64},
+    [SPRITE_DEFENDER_TYPE_1] = {"Blocks/blocks_24.png", 64, 64},
+    [SPRITE_DEFENDER_TYPE_2] = {"Blocks/blocks_58.png", 64, 64},
+    [SPRITE_PROJECTILE_TYPE_1] = {"Blocks/blocks_12.png", TILE_WIDTH / 2, TILE_WIDTH / 2},
+};
+
+const enum SpriteId GAME_OBJECT_SPRITES[] = {
+    [ENEMY_TYPE_1] = SPRITE_ENEMY_TYPE_1,
+    [ENEMY_TYPE_2] = SPRITE_ENEMY_TYPE_2,
+    [DEFENDER_TYPE_1] = SPRITE_DEFENDER_TYPE_1,
+    [DEFENDER_TYPE_2] = SPRITE_DEFENDER_TYPE_2,
+    [PROJECTILE_TYPE_1] = SPRITE_PROJECTILE_TYPE_1,
+};
+
+void spritePath(char* path, enum SpriteId sprite) {
+    sprintf(path, "./assets/Isometric_Tiles_Pixel_Art/%s", SPRITE_SOURCES[sprite].filename);
+}
+
+Image loadSpriteImage(enum SpriteId sprite) {
+    SpriteSource source = SPRITE_SOURCES[sprite];
+
+    char path[256];
+    spritePath(path, sprite);
+    Image image = LoadImage(path);
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    if (image.width != source.width || image.height != source.height) {
+        ImageResize(&image, source.width, source.height);
+    }
+    return image;
+}
+
+int packAtlasSprites(Rectangle* sprites) {
+    // shelf packing, the sprites are few and almost all the same size
+    int x = ATLAS_PADDING;
+    int y = ATLAS_PADDING;
+    int shelf_height = 0;
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        SpriteSource source = SPRITE_SOURCES[s];
+        if (x + source.width + ATLAS_PADDING > ATLAS_WIDTH) {
+            x = ATLAS_PADDING;
+            y += shelf_height + ATLAS_PADDING;
+            shelf_height = 0;
+        }
+        sprites[s] = (Rectangle) {x, y, source.width, source.height};
+        x += source.width + ATLAS_PADDING;
+        if (source.height > shelf_height) {
+            shelf_height = source.height;
+        }
+    }
+
+    int height = 1;
+    while (height < y + shelf_height + ATLAS_PADDING) {
+        height *= 2;
+    }
+    return height;
+}
+
+Image packAtlasImage(Image* images, Rectangle* sprites) {
+    Image atlas = GenImageColor(ATLAS_WIDTH, packAtlasSprites(sprites), BLANK);
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        // copied as they are like uploadSprite() does, ImageDraw() would blend them into the blank atlas
+        for (int row = 0; row < images[s].height; row++) {
+            Color* to = (Color*) atlas.data + ((int) sprites[s].y + row) * atlas.width + (int) sprites[s].x;
+            memcpy(to, (Color*) images[s].data + row * images[s].width, images[s].width * sizeof(Color));
+        }
+    }
+    return atlas;
+}
+
+Image buildAtlasImage(Rectangle* sprites) {
+    Image images[SPRITE_COUNT];
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        images[s] = loadSpriteImage(s);
+    }
+
+    Image atlas_image = packAtlasImage(images, sprites);
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        UnloadImage(images[s]);
+    }
+    return atlas_image;
+}
+
+// fnv-1a over the file names, the sprite sizes and the length and modification time of every file.
+// changes whenever a sprite is added, swapped, resized or its png exported again, without reading the pngs
+unsigned int spriteSourcesHash(void) {
+    unsigned int hash = 2166136261u;
+    for (int s = 0; s < SPRITE_COUNT; s++) {
+        SpriteSource source = SPRITE_SOURCES[s];
+        char path[256];
+        spritePath(path, s);
+        // a missing file hashes as empty, the png loading reports it
+        struct stat info;
+        long long file[3] = {0};
+        if (stat(path, &info) == 0) {
+            file[0] = info.st_size;
+            file[1] = info.st_mtim.tv_sec;
+            file[2] = info.st_mtim.tv_nsec;
+        }
+
+        int sizes[2] = {source.width, source.height};
+        const unsigned char* bytes[3] = {(const unsigned char*) source.filename, (const unsigned char*) sizes, (const unsigned char*) file};
+        size_t lengths[3] = {strlen(source.filename) + 1, sizeof(sizes), sizeof(file)};
+        for (int part = 0; part < 3; part++) {
+            for (size_t b = 0; b < lengths[part]; b++) {
+                hash = (hash ^ bytes[part][b]) * 16777619u;
+            }
+        }
+    }
+    return hash;
+}
+
+bool saveAtlasBundle(Image atlas_image, Rectangle* sprites, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    AtlasBundleHeader header = {
+        .magic = ATLAS_BUNDLE_MAGIC,
+        .version = ATLAS_BUNDLE_VERSION,
+        .sources_hash = spriteSourcesHash(),
+        .sprite_count = SPRITE_COUNT,
+        .width = atlas_image.width,
+        .height = atlas_image.height,
+    };
+    size_t pixel_bytes = (size_t) atlas_image.width * atlas_image.height * 4;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(sprites, sizeof(Rectangle), SPRITE_COUNT, file) == SPRITE_COUNT
+        && fwrite(atlas_image.data, pixel_bytes, 1, file) == 1;
+    return fclose(file) == 0 && written;
+}
+
+bool loadAtlasBundle(Atlas* atlas, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || (size_t) info.st_size < sizeof(AtlasBundleHeader)) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    const AtlasBundleHeader* header = mapped;
+    size_t pixels_offset = sizeof(AtlasBundleHeader) + SPRITE_COUNT * sizeof(Rectangle);
+    bool usable = header->magic == ATLAS_BUNDLE_MAGIC
+        && header->version == ATLAS_BUNDLE_VERSION
+        && header->sources_hash == spriteSourcesHash()
+        && header->sprite_count == SPRITE_COUNT
+        && (size_t) info.st_size == pixels_offset + (size_t) header->width * header->height * 4;
+
+    if (usable) {
+        memcpy(atlas->sprites, (const char*) mapped + sizeof(AtlasBundleHeader), sizeof(atlas->sprites));
+        // straight from the mapping to the gpu, the image is never copied or freed
+        Image image = {
+            .data = (char*) mapped + pixels_offset,
+            .width = header->width,
+            .height = header->height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        };
+        atlas->texture = LoadTextureFromImage(image);
+    }
+    munmap(mapped, info.st_size);
+    return usable;
+}
+
+Atlas loadAtlas(void) {
+    Atlas atlas = {0};
+    double started = profilerNow();
+
+    if (loadAtlasBundle(&atlas, ATLAS_BUNDLE)) {
+        TraceLog(LOG_INFO, "ATLAS: loaded %s in %.2f ms", ATLAS_BUNDLE, (profilerNow() - started) * 1000);
+        return atlas;
+    }
+
+    Image atlas_image = buildAtlasImage(atlas.sprites);
+    atlas.texture = LoadTextureFromImage(atlas_image);
+    UnloadImage(atlas_image);
+    TraceLog(LOG_INFO, "ATLAS: no usable %s, decoded the sprites in %.2f ms", ATLAS_BUNDLE, (profilerNow() - started) * 1000);
+    return atlas;
+}
+
+Atlas blankAtlas(void) {
+    Atlas atlas = {0};
+    Image blank = GenImageColor(ATLAS_WIDTH, packAtlasSprites(atlas.sprites), BLANK);
+    atlas.texture = LoadTextureFromImage(blank);
+    UnloadImage(blank);
+    return atlas;
+}
+
+void uploadSprite(Atlas* atlas, enum SpriteId sprite, Image image) {
+    UpdateTextureRec(atlas->texture, atlas->sprites[sprite], image.data);
+}
+
+void unloadAtlas(Atlas* atlas) {
+    UnloadTexture(atlas->texture);
+    *atlas = (Atlas) {0};
+}
+
+void drawSprite(Atlas* atlas, enum SpriteId sprite, Vector2 position, Color tint) {
+    DrawTextureRec(atlas->texture, atlas->sprites[sprite], position, tint);
+}
+
+void drawSpriteRegion(Atlas* atlas, enum SpriteId sprite, Rectangle region, Vector2 position, Color tint) {
+    Rectangle source = atlas->sprites[sprite];
+    source = (Rectangle) {source.x + region.x, source.y + region.y, region.width, region.height};
+    DrawTextureRec(atlas->texture, source, position, tint);
+}
+
+Rectangle spriteBottom(Atlas* atlas, enum SpriteId sprite, float fraction) {
+    Rectangle source = atlas->sprites[sprite];
+    float hidden = source.height * (1 - fraction);
+    return (Rectangle) {0, hidden, source.width, source.height - hidden};
+}
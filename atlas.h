@@ -0,0 +1,79 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "raylib.h"
+#include "game.h"
+
+// every sprite the game draws, packed into one texture so drawing does not switch textures
+enum SpriteId {
+    SPRITE_GROUND_GRASS,
+    SPRITE_GROUND_PAVEMENT,
+    SPRITE_GROUND_SAND,
+    SPRITE_MOUSEOVER,
+    SPRITE_FULL_OVERLAY,
+    SPRITE_HALF_OVERLAY,
+    SPRITE_ENEMY_TYPE_1,
+    SPRITE_ENEMY_TYPE_2,
+    SPRITE_DEFENDER_TYPE_1,
+    SPRITE_DEFENDER_TYPE_2,
+    SPRITE_PROJECTILE_TYPE_1,
+    SPRITE_COUNT,
+};
+
+typedef struct SpriteSource {
+    char* filename; // relative to the asset directory
+    int width; // the image is resized when it differs from the file
+    int height;
+} SpriteSource;
+
+typedef struct Atlas {
+    Texture2D texture;
+    Rectangle sprites[SPRITE_COUNT]; // pixel rectangle of every sprite in the texture
+} Atlas;
+
+// the packed atlas as it is uploaded, written offline by game-pack so startup skips the png decoding.
+// make pack-assets writes it again after the sprites change
+#define ATLAS_BUNDLE "./assets/atlas.bundle"
+#define ATLAS_BUNDLE_MAGIC 0x54414c42 // "BLAT"
+#define ATLAS_BUNDLE_VERSION 2
+
+// followed by the sprite rectangles, then width * height rgba8 pixels
+typedef struct AtlasBundleHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int sources_hash; // of SPRITE_SOURCES and their files, a bundle packed from other sprites is not used
+    int sprite_count;
+    int width;
+    int height;
+} AtlasBundleHeader;
+
+extern const SpriteSource SPRITE_SOURCES[SPRITE_COUNT];
+// sprite of every GeneralObjectType
+extern const enum SpriteId GAME_OBJECT_SPRITES[];
+
+// decoded and resized to its SpriteSource size, touches no gl so any thread can call it
+Image loadSpriteImage(enum SpriteId sprite);
+// where every sprite goes in the atlas, from the SpriteSource sizes. returns the atlas height
+int packAtlasSprites(Rectangle* sprites);
+// packs the images into one, filling in where each one went
+Image packAtlasImage(Image* images, Rectangle* sprites);
+// decodes every sprite and packs them
+Image buildAtlasImage(Rectangle* sprites);
+bool saveAtlasBundle(Image atlas_image, Rectangle* sprites, const char* path);
+// maps the bundle and uploads it as it is, false if it is missing or out of date
+bool loadAtlasBundle(Atlas* atlas, const char* path);
+// from ATLAS_BUNDLE, or from the pngs when there is no usable bundle
+Atlas loadAtlas(void);
+// the sprite rectangles and a transparent texture for uploadSprite() to fill in
+Atlas blankAtlas(void);
+// copies the decoded image into its place in the texture, on the gl thread
+void uploadSprite(Atlas* atlas, enum SpriteId sprite, Image image);
+void unloadAtlas(Atlas* atlas);
+
+void drawSprite(Atlas* atlas, enum SpriteId sprite, Vector2 position, Color tint);
+// part of a sprite, region is in the sprite's own pixels
+void drawSpriteRegion(Atlas* atlas, enum SpriteId sprite, Rectangle region, Vector2 position, Color tint);
+// the bottom fraction of a sprite where the whole sprite would be, for bars filling up
+Rectangle spriteBottom(Atlas* atlas, enum SpriteId sprite, float fraction);
+
+#endif
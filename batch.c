@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "game.h"
+#include "wave.h"
+#include "profiler.h"
+#include "lcg.h"
+
+// runs many defense layouts against one wave, one independent game state per scenario, on every core.
+// a scenario is a line of "x,y x,y ..." defense cells in the scenario file, or a random layout with --random.
+// usage: game-batch [SCENARIO_FILE] [--random N] [--defenses K] [--seed N] [--wave FILE] [--grid WxH] [--ticks N] [--threads N] [--out CSV]
+//
+// the profiler and the trace recorder are global and not thread safe, they stay disabled here
+
+typedef struct DefenseCell {
+    int x;
+    int y;
+} DefenseCell;
+
+typedef struct Scenario {
+    int first_defense; // into the cells of the batch
+    int defense_count;
+} Scenario;
+
+typedef struct ScenarioResult {
+    int enemies_killed;
+    int enemies_leaked;
+    int projectiles_fired;
+    double clear_time; // -1 if the wave was not cleared in time
+    long ticks;
+} ScenarioResult;
+
+// scenarios not run yet, owned by one worker. the owner takes from the front,
+// idle workers steal the back half
+typedef struct WorkQueue {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+} WorkQueue;
+
+typedef struct Batch {
+    Scenario* scenarios;
+    ScenarioResult* results;
+    int count;
+    DefenseCell* cells; // of every scenario, one after the other
+    int cell_count;
+    int cell_capacity;
+    EnemyWave wave;
+    int grid_width;
+    int grid_height;
+    GameMap* map; // the terrain every scenario starts on, scenario cells are checked against it
+    long max_ticks;
+    WorkQueue* queues;
+    int thread_count;
+} Batch;
+
+typedef struct Worker {
+    Batch* batch;
+    int id;
+} Worker;
+
+ScenarioResult runScenario(Batch* batch, Scenario* scenario) {
+    GameState game_state = {0};
+    for (int d = 0; d < scenario->defense_count; d++) {
+        DefenseCell cell = batch->cells[scenario->first_defense + d];
+        queueCommand(&game_state, (GameCommand) {.tick=0, .x=cell.x, .y=cell.y, .type=DEFENDER_TYPE_1});
+    }
+    ScenarioResult result = {.clear_time=-1};
+    if (!setupMap(&game_state, batch->grid_width, batch->grid_height) || !setupLevelWithWave(&game_state, &batch->wave)) {
+        freeGameState(&game_state);
+        return result;
+    }
+
+    while (game_state.tick < batch->max_ticks) {
+        update(&game_state, SIM_DT);
+        if (levelCleared(&game_state)) {
+            result.clear_time = game_state.time;
+            break;
+        }
+    }
+
+    result.enemies_killed = game_state.stats.enemies_killed;
+    result.enemies_leaked = game_state.stats.enemies_leaked;
+    result.projectiles_fired = game_state.stats.projectiles_fired;
+    result.ticks = game_state.tick;
+    freeGameState(&game_state);
+    return result;
+}
+
+// next scenario of the worker's own queue, -1 when it is empty
+int takeScenario(WorkQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    int scenario = queue->begin < queue->end ? queue->begin++ : -1;
+    pthread_mutex_unlock(&queue->lock);
+    return scenario;
+}
+
+// moves the back half of another worker's queue into the empty queue of the thief
+bool stealScenarios(Batch* batch, int thief) {
+    for (int i = 1; i < batch->thread_count; i++) {
+        WorkQueue* victim = &batch->queues[(thief + i) % batch->thread_count];
+
+        pthread_mutex_lock(&victim->lock);
+        int left = victim->end - victim->begin;
+        int stolen_begin = victim->end - (left + 1) / 2;
+        int stolen_end = victim->end;
+        if (left > 0) {
+            victim->end = stolen_begin;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (left > 0) {
+            WorkQueue* own = &batch->queues[thief];
+            pthread_mutex_lock(&own->lock);
+            own->begin = stolen_begin;
+            own->end = stolen_end;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+void* runWorker(void* arg) {
+    Worker* worker = arg;
+    Batch* batch = worker->batch;
+
+    while (true) {
+        int scenario = takeScenario(&batch->queues[worker->id]);
+        if (scenario == -1) {
+            if (!stealScenarios(batch, worker->id)) { break; }
+            continue;
+        }
+        batch->results[scenario] = runScenario(batch, &batch->scenarios[scenario]);
+    }
+    return NULL;
+}
+
+unsigned int batch_seed;
+
+void addCell(Batch* batch, int x, int y) {
+    if (batch->cell_count >= batch->cell_capacity) {
+        batch->cell_capacity = batch->cell_capacity == 0 ? 1024 : batch->cell_capacity * 2;
+        batch->cells = realloc(batch->cells, batch->cell_capacity * sizeof(DefenseCell));
+    }
+    batch->cells[batch->cell_count++] = (DefenseCell) {.x=x, .y=y};
+}
+
+Scenario* addScenario(Batch* batch, int* capacity) {
+    if (batch->count >= *capacity) {
+        *capacity = *capacity == 0 ? 256 : *capacity * 2;
+        batch->scenarios = realloc(batch->scenarios, *capacity * sizeof(Scenario));
+    }
+    Scenario* scenario = &batch->scenarios[batch->count++];
+    *scenario = (Scenario) {.first_defense=batch->cell_count};
+    return scenario;
+}
+
+// defenses on the cells the player may use, see grabUserInput()
+void addRandomScenario(Batch* batch, int* capacity, int defense_count) {
+    Scenario* scenario = addScenario(batch, capacity);
+    for (int d = 0; d < defense_count; d++) {
+        addCell(batch, 6 + lcgInt(&batch_seed, batch->grid_width - 8), lcgInt(&batch_seed, batch->grid_height));
+    }
+    scenario->defense_count = defense_count;
+}
+
+// the same placement rule the game has, a cell the player could not use is an error
+bool parseScenario(Batch* batch, Scenario* scenario, char* line, const char* path, int line_number) {
+    for (char* cell = strtok(line, " \t\r\n"); cell != NULL; cell = strtok(NULL, " \t\r\n")) {
+        int x, y;
+        if (sscanf(cell, "%d,%d", &x, &y) != 2) {
+            fprintf(stderr, "%s:%d: expected defense cells as \"x,y x,y ...\"\n", path, line_number);
+            return false;
+        }
+        if (!canPlaceDefense(batch->map, x, y)) {
+            fprintf(stderr, "%s:%d: no defense can be placed on %d,%d, only on the grass of the %dx%d grid\n", path, line_number, x, y, batch->grid_width, batch->grid_height);
+            return false;
+        }
+        addCell(batch, x, y);
+        scenario->defense_count++;
+    }
+    return true;
+}
+
+bool loadScenarios(Batch* batch, int* capacity, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "could not open %s\n", path);
+        return false;
+    }
+
+    char line[8192];
+    for (int line_number = 1; fgets(line, sizeof(line), file) != NULL; line_number++) {
+        char* comment = strchr(line, '#');
+        if (comment != NULL) { *comment = '\0'; }
+
+        char blank[2];
+        if (sscanf(line, " %1s", blank) != 1) { continue; }
+
+        if (!parseScenario(batch, addScenario(batch, capacity), line, path, line_number)) {
+            fclose(file);
+            return false;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    char* scenario_path = NULL;
+    char* wave_path = WAVE_DEFAULT;
+    char* output_path = "batch_results.csv";
+    int random_count = 0;
+    int random_defenses = 8;
+    int grid_width = GRID_DEFAULT_SIZE;
+    int grid_height = GRID_DEFAULT_SIZE;
+    int thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    // ten minutes of game time
+    long max_ticks = 600 * SIM_TICK_RATE;
+    batch_seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--random") == 0 && i + 1 < argc) {
+            random_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--defenses") == 0 && i + 1 < argc) {
+            random_defenses = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            batch_seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--wave") == 0 && i + 1 < argc) {
+            wave_path = argv[++i];
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &grid_width, &grid_height) != 2) {
+                fprintf(stderr, "invalid grid size: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            max_ticks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (argv[i][0] != '-' && scenario_path == NULL) {
+            scenario_path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [SCENARIO_FILE] [--random N] [--defenses K] [--seed N] [--wave FILE] [--grid WxH] [--ticks N] [--threads N] [--out CSV]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (thread_count < 1) thread_count = 1;
+    if (random_defenses < 0) random_defenses = 0;
+
+    // the map every scenario starts on. the wave and the scenario cells are checked against it once
+    // here, a wave that does not fit would otherwise leave every scenario with an empty result
+    GameState layout = {0};
+    if (!setupMap(&layout, grid_width, grid_height)) {
+        return 1;
+    }
+
+    Batch batch = {.grid_width=grid_width, .grid_height=grid_height, .map=&layout.map, .max_ticks=max_ticks, .thread_count=thread_count};
+    if (!loadWave(&batch.wave, wave_path) || !waveFitsMap(&batch.wave, batch.map)) {
+        freeGameState(&layout);
+        return 1;
+    }
+
+    int scenario_capacity = 0;
+    if (scenario_path != NULL && !loadScenarios(&batch, &scenario_capacity, scenario_path)) {
+        return 1;
+    }
+    for (int s = 0; s < random_count; s++) {
+        addRandomScenario(&batch, &scenario_capacity, random_defenses);
+    }
+    if (batch.count == 0) {
+        fprintf(stderr, "no scenarios, pass a scenario file or --random N\n");
+        return 1;
+    }
+
+    // every worker starts with an even share, the stealing evens out scenarios that run longer
+    batch.results = calloc(batch.count, sizeof(ScenarioResult));
+    batch.queues = malloc(thread_count * sizeof(WorkQueue));
+    for (int t = 0; t < thread_count; t++) {
+        pthread_mutex_init(&batch.queues[t].lock, NULL);
+        batch.queues[t].begin = (long) batch.count * t / thread_count;
+        batch.queues[t].end = (long) batch.count * (t + 1) / thread_count;
+    }
+
+    double started = profilerNow();
+    pthread_t* threads = malloc(thread_count * sizeof(pthread_t));
+    Worker* workers = malloc(thread_count * sizeof(Worker));
+    for (int t = 0; t < thread_count; t++) {
+        workers[t] = (Worker) {.batch=&batch, .id=t};
+        pthread_create(&threads[t], NULL, runWorker, &workers[t]);
+    }
+    for (int t = 0; t < thread_count; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = profilerNow() - started;
+
+    FILE* output = fopen(output_path, "w");
+    if (output == NULL) {
+        fprintf(stderr, "could not open %s\n", output_path);
+        return 1;
+    }
+    fprintf(output, "scenario,defenses,enemies_killed,enemies_leaked,clear_time,projectiles_fired,ticks\n");
+    int cleared = 0;
+    for (int s = 0; s < batch.count; s++) {
+        ScenarioResult* result = &batch.results[s];
+        fprintf(output, "%d,%d,%d,%d,%.3f,%d,%ld\n", s, batch.scenarios[s].defense_count, result->enemies_killed, result->enemies_leaked, result->clear_time, result->projectiles_fired, result->ticks);
+        cleared += result->clear_time >= 0;
+    }
+    fclose(output);
+
+    printf("scenarios: %d\n", batch.count);
+    printf("threads: %d\n", thread_count);
+    printf("wall time: %.3fs\n", elapsed);
+    printf("scenarios/s: %.0f\n", elapsed > 0 ? batch.count / elapsed : 0);
+    printf("cleared: %d\n", cleared);
+    printf("results: %s\n", output_path);
+
+    for (int t = 0; t < thread_count; t++) {
+        pthread_mutex_destroy(&batch.queues[t].lock);
+    }
+    free(threads);
+    free(workers);
+    free(batch.queues);
+    free(batch.results);
+    free(batch.scenarios);
+    free(batch.cells);
+    freeWave(&batch.wave);
+    freeGameState(&layout);
+    return 0;
+}
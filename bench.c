@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "flow_field.h"
+#include "draw_order.h"
+#include "profiler.h"
+#include "lcg.h"
+#include "scratch.h"
+
+// micro benchmarks of the simulation hot paths, no window needed.
+// --flow-check instead compares flow field repairs against full builds, it fails on any difference
+// usage: game-bench [OUTPUT_CSV] | game-bench --flow-check
+
+#define BENCH_REPEATS 5
+
+const int ENTITY_COUNTS[] = {100, 1000, 10000, 100000};
+#define ENTITY_COUNT_STEPS (sizeof(ENTITY_COUNTS) / sizeof(ENTITY_COUNTS[0]))
+
+typedef struct BenchResult {
+    const char* name;
+    int entities;
+    int ticks; // iterations over all the entities
+    double ns_per_entity_tick; // best of BENCH_REPEATS
+} BenchResult;
+
+// keeps the optimizer from dropping work whose result is unused
+volatile float bench_sink;
+
+unsigned int bench_seed;
+
+// half enemies, a quarter defenses and a quarter projectiles, scattered over the grid.
+// enemies do not die, so the counts stay the same for the whole run
+void populate(GameState* game_state, int entities) {
+    bench_seed = 42;
+    *game_state = (GameState) {0};
+    setupMap(game_state, GRID_DEFAULT_SIZE, GRID_DEFAULT_SIZE);
+
+    for (int i = 0; i < entities / 2; i++) {
+        addEnemy(vec2((int) lcgFloat(&bench_seed, GRID_DEFAULT_SIZE - 1), (int) lcgFloat(&bench_seed, GRID_DEFAULT_SIZE)), i % 2 ? ENEMY_TYPE_2 : ENEMY_TYPE_1, game_state);
+        game_state->game_objects.enemies.life[i] = 1e30f;
+    }
+    for (int i = 0; i < entities / 4; i++) {
+        addDefense(vec2(6 + (int) lcgFloat(&bench_seed, GRID_DEFAULT_SIZE - 8), (int) lcgFloat(&bench_seed, GRID_DEFAULT_SIZE)), DEFENDER_TYPE_1, game_state);
+    }
+    for (int i = 0; i < entities - entities / 2 - entities / 4; i++) {
+        addProjectile(lcgFloat(&bench_seed, GRID_DEFAULT_SIZE), (int) lcgFloat(&bench_seed, GRID_DEFAULT_SIZE), PROJECTILE_TYPE_1, game_state);
+    }
+}
+
+double benchUpdate(int entities, int ticks) {
+    GameState game_state;
+    populate(&game_state, entities);
+
+    double started = profilerNow();
+    for (int t = 0; t < ticks; t++) {
+        update(&game_state, SIM_DT);
+        // keep the projectile count steady, the ones that hit are replaced
+        while (gameObjectCount(&game_state) < entities) {
+            addProjectile(GRID_DEFAULT_SIZE - 1, (int) lcgFloat(&bench_seed, GRID_DEFAULT_SIZE), PROJECTILE_TYPE_1, &game_state);
+        }
+    }
+    double elapsed = profilerNow() - started;
+
+    freeGameState(&game_state);
+    return elapsed;
+}
+
+double benchCollision(int entities, int ticks) {
+    GameState game_state;
+    populate(&game_state, entities);
+    // builds the row index
+    update(&game_state, 0);
+
+    Vector2* queries = malloc(entities * sizeof(Vector2));
+    for (int i = 0; i < entities; i++) {
+        queries[i] = vec2(lcgFloat(&bench_seed, GRID_DEFAULT_SIZE), (int) lcgFloat(&bench_seed, GRID_DEFAULT_SIZE));
+    }
+
+    int hits = 0;
+    double started = profilerNow();
+    for (int t = 0; t < ticks; t++) {
+        for (int i = 0; i < entities; i++) {
+            hits += checkProjectileCollision(queries[i], &game_state) != -1;
+        }
+    }
+    double elapsed = profilerNow() - started;
+    bench_sink = hits;
+
+    free(queries);
+    freeGameState(&game_state);
+    return elapsed;
+}
+
+double benchDepthSort(int entities, int ticks) {
+    GameState game_state;
+    populate(&game_state, entities);
+    // builds the row index the enemies are drawn from
+    update(&game_state, 0);
+    VisibleCells visible = wholeMap(&game_state.map);
+    DrawOrder order = {0};
+
+    double started = profilerNow();
+    for (int t = 0; t < ticks; t++) {
+        scratchReset();
+        updateDrawOrder(&order, &game_state, &visible);
+    }
+    double elapsed = profilerNow() - started;
+    bench_sink = order.items[0].index;
+
+    freeGameState(&game_state);
+    return elapsed;
+}
+
+double benchIso(int entities, int ticks) {
+    Vector2* points = malloc(entities * sizeof(Vector2));
+    bench_seed = 42;
+    for (int i = 0; i < entities; i++) {
+        points[i] = vec2(lcgFloat(&bench_seed, GRID_DEFAULT_SIZE), lcgFloat(&bench_seed, GRID_DEFAULT_SIZE));
+    }
+
+    float sum = 0;
+    double started = profilerNow();
+    for (int t = 0; t < ticks; t++) {
+        for (int i = 0; i < entities; i++) {
+            Vector2 round_trip = fromIso(toIso(points[i], true), false);
+            sum += round_trip.x + round_trip.y;
+        }
+    }
+    double elapsed = profilerNow() - started;
+    bench_sink = sum;
+
+    free(points);
+    return elapsed;
+}
+
+double benchSpawn(int entities, int ticks) {
+    double elapsed = 0;
+    for (int t = 0; t < ticks; t++) {
+        GameState game_state = {0};
+        bench_seed = 42;
+        // sets up the arena, so only the growth that spawning causes is timed
+        presizeGameObjects(&game_state, 0, 0, 0);
+
+        double started = profilerNow();
+        for (int i = 0; i < entities; i++) {
+            int row = i % GRID_DEFAULT_SIZE;
+            if (i % 3 == 0) {
+                addEnemy(vec2(0, row), ENEMY_TYPE_1, &game_state);
+            } else if (i % 3 == 1) {
+                addDefense(vec2(10, row), DEFENDER_TYPE_1, &game_state);
+            } else {
+                addProjectile(9, row, PROJECTILE_TYPE_1, &game_state);
+            }
+        }
+        elapsed += profilerNow() - started;
+
+        freeGameState(&game_state);
+    }
+    return elapsed;
+}
+
+typedef struct FlowCheckGrid {
+    int width;
+    int height;
+    int steps;
+    int check_every; // a full build of the biggest grid takes long, it is compared less often
+} FlowCheckGrid;
+
+const FlowCheckGrid FLOW_CHECK_GRIDS[] = {
+    {64, 64, 3000, 1},
+    {256, 256, 2000, 1},
+    {GRID_MAX, GRID_MAX, 500, 50},
+};
+#define FLOW_CHECK_GRID_COUNT (sizeof(FLOW_CHECK_GRIDS) / sizeof(FLOW_CHECK_GRIDS[0]))
+
+bool flowFieldsMatch(FlowField* a, FlowField* b) {
+    size_t cells = a->width * a->height;
+    return memcmp(a->distance, b->distance, cells * sizeof(float)) == 0
+        && memcmp(a->next, b->next, cells * sizeof(int)) == 0
+        && memcmp(a->blockers, b->blockers, cells * sizeof(int)) == 0;
+}
+
+// places and removes defenses on random grass cells, mostly one at a time and sometimes in bursts
+// that take the full build path. returns the steps whose repaired field differs from a full build
+int checkFlowRepairs(FlowCheckGrid grid) {
+    GameState game_state = {0};
+    setupMap(&game_state, grid.width, grid.height);
+    FlowField* field = &game_state.flow_field;
+    Defenses* defenses = &game_state.game_objects.defenses;
+    updateFlowField(field, defenses);
+
+    FlowField reference;
+    initFlowField(&reference, grid.width, grid.height);
+
+    EntityHandle* placed = malloc(grid.steps * FLOW_REPAIR_MAX_CHANGES * 2 * sizeof(EntityHandle));
+    int placed_count = 0;
+    int mismatches = 0;
+    double repair_time = 0;
+    long repair_cells = 0;
+    int repairs = 0;
+    bench_seed = 42;
+
+    for (int s = 0; s < grid.steps; s++) {
+        int changes = lcgInt(&bench_seed, 10) == 0 ? 1 + lcgInt(&bench_seed, 2 * FLOW_REPAIR_MAX_CHANGES) : 1;
+        for (int c = 0; c < changes; c++) {
+            if (placed_count > 0 && lcgInt(&bench_seed, 2) == 0) {
+                int p = lcgInt(&bench_seed, placed_count);
+                removeGameObject(&game_state.game_objects, placed[p]);
+                placed[p] = placed[--placed_count];
+            } else {
+                // the grass between the sand and the goal, see setupMap()
+                Vector2 cell = vec2(6 + lcgInt(&bench_seed, grid.width - 8), lcgInt(&bench_seed, grid.height));
+                placed[placed_count++] = addDefense(cell, DEFENDER_TYPE_1, &game_state);
+            }
+        }
+
+        int repairs_before = field->repairs;
+        double started = profilerNow();
+        updateFlowField(field, defenses);
+        if (field->repairs != repairs_before) {
+            repair_time += profilerNow() - started;
+            repair_cells += field->last_fix_cells;
+            repairs++;
+        }
+
+        if (s % grid.check_every == 0 || s == grid.steps - 1) {
+            buildFlowField(&reference, defenses);
+            if (!flowFieldsMatch(field, &reference)) {
+                fprintf(stderr, "flow check %dx%d: step %d differs from a full build\n", grid.width, grid.height, s);
+                mismatches++;
+            }
+        }
+    }
+
+    double started = profilerNow();
+    buildFlowField(&reference, defenses);
+    double build_time = profilerNow() - started;
+    printf("flow check %4dx%-4d %5d steps %3d mismatches   repair %8.1f us %6.0f cells   full build %8.1f us   %d full rebuilds\n",
+        grid.width, grid.height, grid.steps, mismatches, repairs > 0 ? repair_time * 1e6 / repairs : 0,
+        repairs > 0 ? (double) repair_cells / repairs : 0, build_time * 1e6, field->full_rebuilds);
+
+    free(placed);
+    freeFlowField(&reference);
+    freeGameState(&game_state);
+    return mismatches;
+}
+
+typedef double (*BenchFunction)(int entities, int ticks);
+
+typedef struct Bench {
+    const char* name;
+    BenchFunction run;
+} Bench;
+
+const Bench BENCHES[] = {
+    {"update", benchUpdate},
+    {"checkProjectileCollision", benchCollision},
+    {"depth_sort", benchDepthSort},
+    {"toIso_fromIso", benchIso},
+    {"spawn", benchSpawn},
+};
+#define BENCH_COUNT (sizeof(BENCHES) / sizeof(BENCHES[0]))
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--flow-check") == 0) {
+        int mismatches = 0;
+        for (size_t g = 0; g < FLOW_CHECK_GRID_COUNT; g++) {
+            mismatches += checkFlowRepairs(FLOW_CHECK_GRIDS[g]);
+        }
+        return mismatches > 0;
+    }
+
+    char* output_path = argc > 1 ? argv[1] : "bench_results.csv";
+    FILE* output = fopen(output_path, "w");
+    if (output == NULL) {
+        fprintf(stderr, "could not open %s\n", output_path);
+        return 1;
+    }
+    fprintf(output, "benchmark,entities,ticks,ns_per_entity_tick\n");
+
+    for (size_t b = 0; b < BENCH_COUNT; b++) {
+        for (size_t n = 0; n < ENTITY_COUNT_STEPS; n++) {
+            int entities = ENTITY_COUNTS[n];
+            // roughly the same amount of work at every size
+            int ticks = 2000000 / entities;
+            if (ticks < 10) ticks = 10;
+
+            double best = 0;
+            for (int r = 0; r < BENCH_REPEATS; r++) {
+                double elapsed = BENCHES[b].run(entities, ticks);
+                if (r == 0 || elapsed < best) {
+                    best = elapsed;
+                }
+            }
+
+            BenchResult result = {
+                .name = BENCHES[b].name,
+                .entities = entities,
+                .ticks = ticks,
+                .ns_per_entity_tick = best * 1e9 / ((double) entities * ticks),
+            };
+            printf("%-26s %7d entities %6d ticks %10.2f ns/entity/tick\n", result.name, result.entities, result.ticks, result.ns_per_entity_tick);
+            fprintf(output, "%s,%d,%d,%.3f\n", result.name, result.entities, result.ticks, result.ns_per_entity_tick);
+        }
+    }
+
+    fclose(output);
+    freeScratch();
+    return 0;
+}
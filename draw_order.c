@@ -0,0 +1,112 @@
+#include <math.h>
+#include "draw_order.h"
+#include "scratch.h"
+
+unsigned int depthCoord(float v) {
+    // shifted by one cell, projectiles can be slightly left of the grid before they are removed
+    float q = (v + 1) * DEPTH_KEY_SCALE;
+    if (q < 0) return 0;
+    if (q > 0xFFFF) return 0xFFFF;
+    return (unsigned int) q;
+}
+
+unsigned int depthKey(Vector2 position) {
+    return (depthCoord(position.y) << 16) | depthCoord(position.x);
+}
+
+void addDrawItem(DrawOrder* order, enum GameObjectType type, int index, Vector2 position) {
+    order->items[order->count] = (DrawItem) {.type=type, .index=index};
+    order->keys[order->count] = depthKey(position);
+    order->count++;
+}
+
+void addVisibleItems(DrawOrder* order, VisibleCells* visible, enum GameObjectType type, Vector2* positions, int count) {
+    for (int i = 0; i < count; i++) {
+        if (positionVisible(visible, positions[i])) {
+            addDrawItem(order, type, i, positions[i]);
+        }
+    }
+}
+
+// enemies are found through the row index instead of testing each one, only the
+// part of a row that is in view is walked. an enemy of row r is somewhere in [r, r + 1)
+void addVisibleEnemies(DrawOrder* order, VisibleCells* visible, GameState* game_state) {
+    GameObjects* game_objects = &game_state->game_objects;
+    int first_row = visible->first_row > 0 ? visible->first_row - 1 : 0;
+
+    for (int r = first_row; r <= visible->last_row; r++) {
+        RowIndex* row = &game_state->enemy_rows[r];
+        float first_x = fmaxf(visible->min_diff + r, visible->min_sum - r - 1);
+        float last_x = fminf(visible->max_diff + r + 1, visible->max_sum - r);
+
+        // first entry at or right of first_x
+        int lo = 0;
+        int hi = row->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (row->entries[mid].x < first_x) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        for (int i = lo; i < row->count && row->entries[i].x <= last_x; i++) {
+            int index = resolveHandle(game_objects, row->entries[i].enemy, ENEMY);
+            if (index == -1) { continue; }
+            Vector2 position = game_objects->enemies.position[index];
+            if (positionVisible(visible, position)) {
+                addDrawItem(order, ENEMY, index, position);
+            }
+        }
+    }
+}
+
+void updateDrawOrder(DrawOrder* order, GameState* game_state, VisibleCells* visible) {
+    GameObjects* game_objects = &game_state->game_objects;
+    int capacity = game_objects->enemies.count + game_objects->defenses.count + game_objects->projectiles.count;
+    order->count = 0;
+    if (capacity == 0) { return; }
+
+    order->items = scratchAlloc(capacity * sizeof(DrawItem));
+    order->keys = scratchAlloc(capacity * sizeof(unsigned int));
+    DrawItem* tmp_items = scratchAlloc(capacity * sizeof(DrawItem));
+    unsigned int* tmp_keys = scratchAlloc(capacity * sizeof(unsigned int));
+
+    addVisibleEnemies(order, visible, game_state);
+    // defenses and projectiles have no index, their test is a few compares
+    addVisibleItems(order, visible, DEFENSE, game_objects->defenses.position, game_objects->defenses.count);
+    addVisibleItems(order, visible, PROJECTILE, game_objects->projectiles.position, game_objects->projectiles.count);
+
+    int count = order->count;
+    if (count == 0) { return; }
+
+    // lsd radix sort, one byte per pass. it is stable, so equal keys keep the store order
+    for (int shift = 0; shift < 32; shift += 8) {
+        int histogram[257] = {0};
+        for (int i = 0; i < count; i++) {
+            histogram[((order->keys[i] >> shift) & 0xFF) + 1]++;
+        }
+
+        // all keys share this byte, the pass would not move anything
+        if (histogram[((order->keys[0] >> shift) & 0xFF) + 1] == count) { continue; }
+
+        for (int b = 0; b < 256; b++) {
+            histogram[b + 1] += histogram[b];
+        }
+
+        for (int i = 0; i < count; i++) {
+            int dest = histogram[(order->keys[i] >> shift) & 0xFF]++;
+            tmp_keys[dest] = order->keys[i];
+            tmp_items[dest] = order->items[i];
+        }
+
+        unsigned int* keys = order->keys;
+        order->keys = tmp_keys;
+        tmp_keys = keys;
+
+        DrawItem* items = order->items;
+        order->items = tmp_items;
+        tmp_items = items;
+    }
+}
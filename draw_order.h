@@ -0,0 +1,29 @@
+#ifndef DRAW_ORDER_H
+#define DRAW_ORDER_H
+
+#include "game.h"
+#include "viewport.h"
+
+// fixed point steps per grid cell used by the depth keys
+#define DEPTH_KEY_SCALE 32
+
+typedef struct DrawItem {
+    enum GameObjectType type;
+    int index; // into the store of its type
+} DrawItem;
+
+// back to front order of the game objects, kept apart from the simulation arrays.
+// the lists live in the frame scratch, they are rebuilt every frame anyway
+typedef struct DrawOrder {
+    DrawItem* items;
+    unsigned int* keys;
+    int count;
+} DrawOrder;
+
+// packs (y, x) into one key, objects are drawn row by row and left to right within a row
+unsigned int depthKey(Vector2 position);
+// only the objects in view are listed. enemies are found through the row index, so
+// ones spawned since the last update() show up after the next one. valid until the next scratchReset()
+void updateDrawOrder(DrawOrder* order, GameState* game_state, VisibleCells* visible);
+
+#endif
@@ -0,0 +1,339 @@
+#include <math.h>
+#include <stdlib.h>
+#include "flow_field.h"
+#include "profiler.h"
+
+typedef struct FlowNode {
+    float distance;
+    int cell;
+} FlowNode;
+
+// the goal is at high x, so +x comes first and a free row is walked straight
+const int FLOW_NEIGHBOURS[4][2] = {{1, 0}, {0, -1}, {0, 1}, {-1, 0}};
+
+typedef struct FlowHeap {
+    FlowNode* nodes; // every cell is pushed at most once per neighbour, plus the goal column
+    int count;
+} FlowHeap;
+
+// working memory of a build or repair, sized for the biggest field seen so far.
+// only one field is worked on at a time per thread
+typedef struct FlowScratch {
+    FlowHeap heap;
+    int* region; // cells whose distance a repair recomputes
+    int region_count;
+    unsigned int* mark; // equal to stamp for the cells in the region
+    unsigned int stamp;
+    int cells;
+} FlowScratch;
+
+static _Thread_local FlowScratch flow_scratch;
+
+FlowScratch* flowScratch(FlowField* field) {
+    FlowScratch* scratch = &flow_scratch;
+    int cells = field->width * field->height;
+    if (cells <= scratch->cells) { return scratch; }
+
+    scratch->heap.nodes = realloc(scratch->heap.nodes, (4 * cells + field->height) * sizeof(FlowNode));
+    scratch->region = realloc(scratch->region, cells * sizeof(int));
+    // stamps of the old cells may be current, a fresh array starts over
+    free(scratch->mark);
+    scratch->mark = calloc(cells, sizeof(unsigned int));
+    scratch->stamp = 0;
+    scratch->cells = cells;
+    return scratch;
+}
+
+void initFlowField(FlowField* field, int width, int height) {
+    int cells = width * height;
+    *field = (FlowField) {.width=width, .height=height};
+    field->distance = malloc(cells * sizeof(float));
+    field->next = malloc(cells * sizeof(int));
+    field->blockers = calloc(cells, sizeof(int));
+}
+
+void freeFlowField(FlowField* field) {
+    free(field->distance);
+    free(field->next);
+    free(field->blockers);
+    *field = (FlowField) {0};
+}
+
+void heapPush(FlowHeap* heap, FlowNode node) {
+    int i = heap->count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap->nodes[parent].distance <= node.distance) { break; }
+        heap->nodes[i] = heap->nodes[parent];
+        i = parent;
+    }
+    heap->nodes[i] = node;
+}
+
+FlowNode heapPop(FlowHeap* heap) {
+    FlowNode top = heap->nodes[0];
+    FlowNode last = heap->nodes[--heap->count];
+
+    int i = 0;
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) { break; }
+        if (child + 1 < heap->count && heap->nodes[child + 1].distance < heap->nodes[child].distance) { child++; }
+        if (last.distance <= heap->nodes[child].distance) { break; }
+        heap->nodes[i] = heap->nodes[child];
+        i = child;
+    }
+    if (heap->count > 0) {
+        heap->nodes[i] = last;
+    }
+    return top;
+}
+
+// neighbour n (0-3) of a cell, -1 past the edge of the grid
+int flowNeighbour(FlowField* field, int cell, int n) {
+    int x = cell % field->width + FLOW_NEIGHBOURS[n][0];
+    int y = cell / field->width + FLOW_NEIGHBOURS[n][1];
+    if (x < 0 || x >= field->width || y < 0 || y >= field->height) return -1;
+    return y * field->width + x;
+}
+
+bool isGoal(FlowField* field, int cell) {
+    return cell % field->width == field->width - 1;
+}
+
+void markRegion(FlowScratch* scratch, int cell) {
+    scratch->mark[cell] = scratch->stamp;
+    scratch->region[scratch->region_count++] = cell;
+}
+
+// dijkstra from the cells on the heap outwards. with record, every cell that
+// gets closer to the goal is added to the region
+void solveFlow(FlowField* field, FlowScratch* scratch, bool record) {
+    FlowHeap* heap = &scratch->heap;
+    while (heap->count > 0) {
+        FlowNode node = heapPop(heap);
+        if (node.distance > field->distance[node.cell]) { continue; }
+
+        float distance = node.distance + 1;
+        for (int n = 0; n < 4; n++) {
+            int neighbour = flowNeighbour(field, node.cell, n);
+            if (neighbour == -1 || field->blockers[neighbour] > 0) { continue; }
+            if (distance >= field->distance[neighbour]) { continue; }
+
+            field->distance[neighbour] = distance;
+            heapPush(heap, (FlowNode) {.distance=distance, .cell=neighbour});
+            if (record && scratch->mark[neighbour] != scratch->stamp) {
+                markRegion(scratch, neighbour);
+            }
+        }
+    }
+}
+
+// first neighbour closest to the goal, blocked cells point at one too so an enemy caught on one can leave
+void pickNext(FlowField* field, int cell) {
+    field->next[cell] = -1;
+    if (isGoal(field, cell) && field->blockers[cell] == 0) { return; }
+
+    float best = field->blockers[cell] > 0 ? INFINITY : field->distance[cell];
+    for (int n = 0; n < 4; n++) {
+        int neighbour = flowNeighbour(field, cell, n);
+        if (neighbour != -1 && field->distance[neighbour] < best) {
+            best = field->distance[neighbour];
+            field->next[cell] = neighbour;
+        }
+    }
+}
+
+// shortest distance to the goal through the cell's neighbours as they are now
+float bestThroughNeighbours(FlowField* field, FlowScratch* scratch, int cell) {
+    if (isGoal(field, cell)) return 0;
+
+    float best = INFINITY;
+    for (int n = 0; n < 4; n++) {
+        int neighbour = flowNeighbour(field, cell, n);
+        if (neighbour == -1 || scratch->mark[neighbour] == scratch->stamp) { continue; }
+        best = fminf(best, field->distance[neighbour] + 1);
+    }
+    return best;
+}
+
+// the region's distances changed, so did the choice of the cells in and around it
+void pickRegionNext(FlowField* field, FlowScratch* scratch) {
+    for (int i = 0; i < scratch->region_count; i++) {
+        int cell = scratch->region[i];
+        pickNext(field, cell);
+        for (int n = 0; n < 4; n++) {
+            int neighbour = flowNeighbour(field, cell, n);
+            if (neighbour != -1) { pickNext(field, neighbour); }
+        }
+    }
+}
+
+// the cells whose route ran through the newly blocked cell lose their distance,
+// they are solved again from the unaffected cells around them
+void blockCell(FlowField* field, FlowScratch* scratch, int blocked) {
+    scratch->stamp++;
+    scratch->region_count = 0;
+    markRegion(scratch, blocked);
+
+    // the cells pointing into the region, recursively
+    for (int i = 0; i < scratch->region_count; i++) {
+        int cell = scratch->region[i];
+        for (int n = 0; n < 4; n++) {
+            int neighbour = flowNeighbour(field, cell, n);
+            if (neighbour == -1 || scratch->mark[neighbour] == scratch->stamp) { continue; }
+            if (field->next[neighbour] == cell) { markRegion(scratch, neighbour); }
+        }
+    }
+
+    for (int i = 0; i < scratch->region_count; i++) {
+        field->distance[scratch->region[i]] = INFINITY;
+    }
+    for (int i = 0; i < scratch->region_count; i++) {
+        int cell = scratch->region[i];
+        if (field->blockers[cell] > 0) { continue; }
+
+        float distance = bestThroughNeighbours(field, scratch, cell);
+        if (distance < INFINITY) {
+            field->distance[cell] = distance;
+            heapPush(&scratch->heap, (FlowNode) {.distance=distance, .cell=cell});
+        }
+    }
+    solveFlow(field, scratch, false);
+    pickRegionNext(field, scratch);
+}
+
+// the freed cell may be a shortcut, the cells that get closer through it are solved again
+void unblockCell(FlowField* field, FlowScratch* scratch, int freed) {
+    scratch->stamp++;
+    scratch->region_count = 0;
+    markRegion(scratch, freed);
+
+    float distance = bestThroughNeighbours(field, scratch, freed);
+    field->distance[freed] = distance;
+    if (distance < INFINITY) {
+        heapPush(&scratch->heap, (FlowNode) {.distance=distance, .cell=freed});
+    }
+    solveFlow(field, scratch, true);
+    pickRegionNext(field, scratch);
+}
+
+void countBlockers(FlowField* field, Defenses* defenses) {
+    for (int c = 0; c < field->width * field->height; c++) {
+        field->blockers[c] = 0;
+    }
+    for (int d = 0; d < defenses->count; d++) {
+        int x = defenses->position[d].x;
+        int y = defenses->position[d].y;
+        if (x < 0 || x >= field->width || y < 0 || y >= field->height) { continue; }
+        field->blockers[y * field->width + x]++;
+    }
+}
+
+// from the goal column outwards over the whole grid, with the blockers already counted
+void solveWholeField(FlowField* field, FlowScratch* scratch) {
+    scratch->heap.count = 0;
+    for (int c = 0; c < field->width * field->height; c++) {
+        field->distance[c] = INFINITY;
+    }
+    for (int y = 0; y < field->height; y++) {
+        int goal = y * field->width + field->width - 1;
+        if (field->blockers[goal] > 0) { continue; }
+        field->distance[goal] = 0;
+        heapPush(&scratch->heap, (FlowNode) {.distance=0, .cell=goal});
+    }
+    solveFlow(field, scratch, false);
+
+    for (int c = 0; c < field->width * field->height; c++) {
+        pickNext(field, c);
+    }
+    field->full_rebuilds++;
+    field->last_fix_cells = field->width * field->height;
+}
+
+void buildFlowField(FlowField* field, Defenses* defenses) {
+    countBlockers(field, defenses);
+    solveWholeField(field, flowScratch(field));
+
+    field->built = true;
+    field->defenses_version = defenses->version;
+}
+
+// new blocker count of every cell the recorded changes touch, each cell once
+int sumDefenseChanges(FlowField* field, Defenses* defenses, int* cells, int* blockers) {
+    int count = 0;
+    for (int i = 0; i < defenses->change_count; i++) {
+        DefenseChange change = defenses->changes[i];
+        if (change.x < 0 || change.x >= field->width || change.y < 0 || change.y >= field->height) { continue; }
+        int cell = change.y * field->width + change.x;
+
+        int c = 0;
+        while (c < count && cells[c] != cell) { c++; }
+        if (c == count) {
+            cells[count] = cell;
+            blockers[count++] = field->blockers[cell];
+        }
+        blockers[c] += change.delta;
+    }
+    return count;
+}
+
+void updateFlowField(FlowField* field, Defenses* defenses) {
+    // the full builds are timed too, they are the slowest fixes
+    double started = profilerNow();
+    if (!field->built || defenses->changes_overflowed) {
+        buildFlowField(field, defenses);
+        defenses->change_count = 0;
+        defenses->changes_overflowed = false;
+    } else {
+        FlowScratch* scratch = flowScratch(field);
+        int touched[DEFENSE_CHANGES_MAX];
+        int blockers[DEFENSE_CHANGES_MAX];
+        int touched_count = sumDefenseChanges(field, defenses, touched, blockers);
+        defenses->change_count = 0;
+
+        // only cells that became blocked or free matter, not a second defense on the same cell
+        int changed_count = 0;
+        for (int i = 0; i < touched_count; i++) {
+            changed_count += (blockers[i] > 0) != (field->blockers[touched[i]] > 0);
+        }
+
+        if (changed_count > FLOW_REPAIR_MAX_CHANGES) {
+            for (int i = 0; i < touched_count; i++) {
+                field->blockers[touched[i]] = blockers[i];
+            }
+            solveWholeField(field, scratch);
+        } else {
+            // one cell at a time, so every repair starts from a consistent field
+            int fixed_cells = 0;
+            for (int i = 0; i < touched_count; i++) {
+                int cell = touched[i];
+                bool was_blocked = field->blockers[cell] > 0;
+                field->blockers[cell] = blockers[i];
+                if (was_blocked == (blockers[i] > 0)) { continue; }
+
+                if (blockers[i] > 0) {
+                    blockCell(field, scratch, cell);
+                } else {
+                    unblockCell(field, scratch, cell);
+                }
+                fixed_cells += scratch->region_count;
+            }
+            field->repairs++;
+            field->last_fix_cells = fixed_cells;
+        }
+    }
+
+    field->defenses_version = defenses->version;
+    profileCounterSet(COUNTER_FLOW_FIX_CELLS, field->last_fix_cells);
+    profileCounterSet(COUNTER_FLOW_FIX_US, (profilerNow() - started) * 1e6);
+    profileCounterSet(COUNTER_FLOW_FULL_REBUILDS, field->full_rebuilds);
+}
+
+Vector2 flowWaypoint(FlowField* field, int x, int y) {
+    int next = field->next[y * field->width + x];
+    if (next == -1) {
+        return (Vector2) {.x=fminf(x + 1, field->width - 1), .y=y};
+    }
+    return (Vector2) {.x=next % field->width, .y=next / field->width};
+}
@@ -0,0 +1,23 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include "game.h"
+
+#define FLOW_REPAIR_MAX_CHANGES 8
+
+// sizes the field for the grid, it is built by the first updateFlowField()
+void initFlowField(FlowField* field, int width, int height);
+void freeFlowField(FlowField* field);
+
+// one dijkstra pass from the goal column over the whole grid, 4-connected.
+// cells with a defense are not entered, but still point at their cheapest neighbour so an enemy caught on one can leave
+void buildFlowField(FlowField* field, Defenses* defenses);
+// brings the field up to date with the defenses placed and removed since the last call, and
+// clears their changes. each cell that became blocked or free is repaired on its own and only
+// the cells whose distance it changes are solved again, nothing scans the whole grid.
+// more changes than FLOW_REPAIR_MAX_CHANGES at once are cheaper as a full build
+void updateFlowField(FlowField* field, Defenses* defenses);
+// next waypoint of an enemy that arrived at the given cell, straight on when it is cut off from the goal
+Vector2 flowWaypoint(FlowField* field, int x, int y);
+
+#endif
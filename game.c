@@ -0,0 +1,860 @@
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "profiler.h"
+#include "trace.h"
+#include "wave.h"
+#include "flow_field.h"
+// the simulation is also built without raylib (headless), so no external definitions are available
+#define RAYMATH_STATIC_INLINE
+#include "raymath.h"
+
+/* global variables start */
+int screen_width;
+int screen_height;
+/* global variables end */
+
+Vector2 vec2(float x, float y) {
+    return (Vector2) {.x=x, .y=y};
+}
+
+// every column of every store, plus the slot table
+#define GAME_ARENA_RESERVE ((size_t) 256 << 20)
+
+void commitColumn(Arena* arena, void* column, size_t element_size, int from, int to) {
+    arenaCommit(arena, column, from * element_size, to * element_size);
+}
+
+int grownCapacity(int count, int capacity) {
+    if (count < capacity) return capacity;
+    if (count >= ENTITY_MAX) {
+        fprintf(stderr, "game objects: more than %d objects of one kind\n", ENTITY_MAX);
+        exit(1);
+    }
+    return capacity + ENTITY_CHUNK;
+}
+
+void growEnemies(Enemies* enemies, Arena* arena, int capacity) {
+    int from = enemies->capacity;
+    commitColumn(arena, enemies->position, sizeof(Vector2), from, capacity);
+    commitColumn(arena, enemies->prev_position, sizeof(Vector2), from, capacity);
+    commitColumn(arena, enemies->waypoint, sizeof(Vector2), from, capacity);
+    commitColumn(arena, enemies->speed, sizeof(float), from, capacity);
+    commitColumn(arena, enemies->life, sizeof(float), from, capacity);
+    commitColumn(arena, enemies->row, sizeof(int), from, capacity);
+    commitColumn(arena, enemies->sub_type, sizeof(enum GeneralObjectType), from, capacity);
+    commitColumn(arena, enemies->slot, sizeof(unsigned int), from, capacity);
+    enemies->capacity = capacity;
+}
+
+void growDefenses(Defenses* defenses, Arena* arena, int capacity) {
+    int from = defenses->capacity;
+    commitColumn(arena, defenses->position, sizeof(Vector2), from, capacity);
+    commitColumn(arena, defenses->last_attacked, sizeof(double), from, capacity);
+    commitColumn(arena, defenses->life, sizeof(float), from, capacity);
+    commitColumn(arena, defenses->sub_type, sizeof(enum GeneralObjectType), from, capacity);
+    commitColumn(arena, defenses->slot, sizeof(unsigned int), from, capacity);
+    defenses->capacity = capacity;
+}
+
+void growProjectiles(Projectiles* projectiles, Arena* arena, int capacity) {
+    int from = projectiles->capacity;
+    commitColumn(arena, projectiles->position, sizeof(Vector2), from, capacity);
+    commitColumn(arena, projectiles->prev_position, sizeof(Vector2), from, capacity);
+    commitColumn(arena, projectiles->sub_type, sizeof(enum GeneralObjectType), from, capacity);
+    commitColumn(arena, projectiles->slot, sizeof(unsigned int), from, capacity);
+    projectiles->capacity = capacity;
+}
+
+void growSlots(EntitySlots* slots, Arena* arena, int capacity) {
+    commitColumn(arena, slots->slots, sizeof(EntitySlot), slots->capacity, capacity);
+    commitColumn(arena, slots->free_slots, sizeof(int), slots->capacity, capacity);
+    slots->capacity = capacity;
+}
+
+// lays out every column at its final address, none of them is committed yet
+void initGameObjects(GameObjects* game_objects) {
+    Arena* arena = &game_objects->arena;
+    arenaInit(arena, GAME_ARENA_RESERVE);
+
+    Enemies* enemies = &game_objects->enemies;
+    enemies->position = arenaReserve(arena, ENTITY_MAX * sizeof(Vector2));
+    enemies->prev_position = arenaReserve(arena, ENTITY_MAX * sizeof(Vector2));
+    enemies->waypoint = arenaReserve(arena, ENTITY_MAX * sizeof(Vector2));
+    enemies->speed = arenaReserve(arena, ENTITY_MAX * sizeof(float));
+    enemies->life = arenaReserve(arena, ENTITY_MAX * sizeof(float));
+    enemies->row = arenaReserve(arena, ENTITY_MAX * sizeof(int));
+    enemies->sub_type = arenaReserve(arena, ENTITY_MAX * sizeof(enum GeneralObjectType));
+    enemies->slot = arenaReserve(arena, ENTITY_MAX * sizeof(unsigned int));
+
+    Defenses* defenses = &game_objects->defenses;
+    defenses->position = arenaReserve(arena, ENTITY_MAX * sizeof(Vector2));
+    defenses->last_attacked = arenaReserve(arena, ENTITY_MAX * sizeof(double));
+    defenses->life = arenaReserve(arena, ENTITY_MAX * sizeof(float));
+    defenses->sub_type = arenaReserve(arena, ENTITY_MAX * sizeof(enum GeneralObjectType));
+    defenses->slot = arenaReserve(arena, ENTITY_MAX * sizeof(unsigned int));
+
+    Projectiles* projectiles = &game_objects->projectiles;
+    projectiles->position = arenaReserve(arena, ENTITY_MAX * sizeof(Vector2));
+    projectiles->prev_position = arenaReserve(arena, ENTITY_MAX * sizeof(Vector2));
+    projectiles->sub_type = arenaReserve(arena, ENTITY_MAX * sizeof(enum GeneralObjectType));
+    projectiles->slot = arenaReserve(arena, ENTITY_MAX * sizeof(unsigned int));
+
+    // every live object holds one slot
+    EntitySlots* slots = &game_objects->slots;
+    slots->slots = arenaReserve(arena, 3 * ENTITY_MAX * sizeof(EntitySlot));
+    slots->free_slots = arenaReserve(arena, 3 * ENTITY_MAX * sizeof(int));
+}
+
+void reserveEnemies(GameObjects* game_objects) {
+    if (game_objects->arena.base == NULL) { initGameObjects(game_objects); }
+
+    Enemies* enemies = &game_objects->enemies;
+    int capacity = grownCapacity(enemies->count, enemies->capacity);
+    if (capacity != enemies->capacity) {
+        growEnemies(enemies, &game_objects->arena, capacity);
+    }
+}
+
+void reserveDefenses(GameObjects* game_objects) {
+    if (game_objects->arena.base == NULL) { initGameObjects(game_objects); }
+
+    Defenses* defenses = &game_objects->defenses;
+    int capacity = grownCapacity(defenses->count, defenses->capacity);
+    if (capacity != defenses->capacity) {
+        growDefenses(defenses, &game_objects->arena, capacity);
+    }
+}
+
+void reserveProjectiles(GameObjects* game_objects) {
+    if (game_objects->arena.base == NULL) { initGameObjects(game_objects); }
+
+    Projectiles* projectiles = &game_objects->projectiles;
+    int capacity = grownCapacity(projectiles->count, projectiles->capacity);
+    if (capacity != projectiles->capacity) {
+        growProjectiles(projectiles, &game_objects->arena, capacity);
+    }
+}
+
+int chunkedCapacity(int count) {
+    if (count > ENTITY_MAX) count = ENTITY_MAX;
+    return (count + ENTITY_CHUNK - 1) / ENTITY_CHUNK * ENTITY_CHUNK;
+}
+
+void presizeGameObjects(GameState* game_state, int enemies, int defenses, int projectiles) {
+    GameObjects* game_objects = &game_state->game_objects;
+    if (game_objects->arena.base == NULL) { initGameObjects(game_objects); }
+
+    Arena* arena = &game_objects->arena;
+    if (chunkedCapacity(enemies) > game_objects->enemies.capacity) {
+        growEnemies(&game_objects->enemies, arena, chunkedCapacity(enemies));
+    }
+    if (chunkedCapacity(defenses) > game_objects->defenses.capacity) {
+        growDefenses(&game_objects->defenses, arena, chunkedCapacity(defenses));
+    }
+    if (chunkedCapacity(projectiles) > game_objects->projectiles.capacity) {
+        growProjectiles(&game_objects->projectiles, arena, chunkedCapacity(projectiles));
+    }
+
+    int slots = chunkedCapacity(enemies) + chunkedCapacity(defenses) + chunkedCapacity(projectiles);
+    if (slots > game_objects->slots.capacity) {
+        growSlots(&game_objects->slots, arena, slots);
+    }
+}
+
+void reportAllocations(GameState* game_state) {
+    GameObjects* game_objects = &game_state->game_objects;
+    Arena* arena = &game_objects->arena;
+
+    printf("arena reserved: %zu KiB\n", arena->reserved / 1024);
+    printf("arena committed: %zu KiB in %d commits\n", arena->committed / 1024, arena->commits);
+    printf("%-12s %9s %9s %9s\n", "store", "count", "peak", "capacity");
+    printf("%-12s %9d %9d %9d\n", "enemies", game_objects->enemies.count, game_objects->enemies.peak, game_objects->enemies.capacity);
+    printf("%-12s %9d %9d %9d\n", "defenses", game_objects->defenses.count, game_objects->defenses.peak, game_objects->defenses.capacity);
+    printf("%-12s %9d %9d %9d\n", "projectiles", game_objects->projectiles.count, game_objects->projectiles.peak, game_objects->projectiles.capacity);
+    printf("%-12s %9d %9s %9d\n", "slots", game_objects->slots.count - game_objects->slots.free_count, "", game_objects->slots.capacity);
+}
+
+Vector2 toIso(Vector2 coord, bool translate_by_half_width) {
+    // calculate screen coordinates
+    float x = (coord.x - coord.y) * (TILE_WIDTH / 2);
+    float y = (coord.x + coord.y) * (TILE_HEIGHT / 2);
+
+    // some translation
+    x -= (TILE_WIDTH / 2) * translate_by_half_width;
+    x += screen_width / 2;
+    y += VERTICAL_OFFSET;
+
+    return vec2(x, y);
+}
+
+Vector2 fromIso(Vector2 screen, bool snap_to_grid) {
+    screen.x -= screen_width / 2;
+    screen.y -= VERTICAL_OFFSET;
+
+    float x = (screen.x / (TILE_WIDTH / 2) + screen.y / (TILE_HEIGHT / 2)) / 2;
+    float y = (screen.y / (TILE_HEIGHT / 2) -(screen.x / (TILE_WIDTH / 2))) / 2;
+
+    if (snap_to_grid) {
+        x = floorf(x);
+        y = floorf(y);
+    }
+
+    return vec2(x, y);
+}
+
+EntityHandle allocateSlot(GameObjects* game_objects, enum GameObjectType type, int index) {
+    EntitySlots* slots = &game_objects->slots;
+    int slot;
+    if (slots->free_count > 0) {
+        slot = slots->free_slots[--slots->free_count];
+    } else {
+        if (slots->count >= slots->capacity) {
+            growSlots(slots, &game_objects->arena, slots->capacity + ENTITY_CHUNK);
+        }
+        slot = slots->count++;
+        slots->slots[slot].generation = 1;
+    }
+
+    slots->slots[slot].type = type;
+    slots->slots[slot].index = index;
+    return (EntityHandle) {.slot=slot, .generation=slots->slots[slot].generation};
+}
+
+void releaseSlot(EntitySlots* slots, unsigned int slot) {
+    // bumping the generation invalidates every handle to the old object
+    slots->slots[slot].generation++;
+    if (slots->slots[slot].generation == 0) {
+        slots->slots[slot].generation = 1;
+    }
+    slots->free_slots[slots->free_count++] = slot;
+}
+
+int resolveHandle(GameObjects* game_objects, EntityHandle handle, enum GameObjectType type) {
+    EntitySlots* slots = &game_objects->slots;
+    if (handle.slot >= (unsigned int) slots->count) return -1;
+
+    EntitySlot* slot = &slots->slots[handle.slot];
+    if (slot->generation != handle.generation || slot->type != type) return -1;
+    return slot->index;
+}
+
+EntityHandle addEnemy(Vector2 position, enum GeneralObjectType type, GameState* game_state) {
+    Enemies* enemies = &game_state->game_objects.enemies;
+    reserveEnemies(&game_state->game_objects);
+
+    int i = enemies->count++;
+    if (enemies->count > enemies->peak) {
+        enemies->peak = enemies->count;
+    }
+    // grid cells per second
+    float speed = 0;
+
+    if (type == ENEMY_TYPE_1) {speed = 0.6;}
+    else if (type == ENEMY_TYPE_2) {speed = 0.24;}
+
+    // movement related parameters, in grid coordinates so the simulation does not depend on the screen.
+    // it first walks to the center of the cell it is on
+    enemies->waypoint[i] = vec2(roundf(position.x), roundf(position.y));
+    enemies->speed[i] = speed;
+    enemies->life[i] = 100; // will be different by the enemy type
+    enemies->row[i] = -1;
+
+    enemies->position[i] = position;
+    enemies->prev_position[i] = position;
+    enemies->sub_type[i] = type;
+
+    EntityHandle handle = allocateSlot(&game_state->game_objects, ENEMY, i);
+    enemies->slot[i] = handle.slot;
+    return handle;
+}
+
+void recordDefenseChange(Defenses* defenses, Vector2 position, int delta) {
+    defenses->version++;
+    if (defenses->change_count == DEFENSE_CHANGES_MAX) {
+        defenses->changes_overflowed = true;
+        return;
+    }
+    defenses->changes[defenses->change_count++] = (DefenseChange) {.x=position.x, .y=position.y, .delta=delta};
+}
+
+EntityHandle addDefense(Vector2 position, enum GeneralObjectType type, GameState* game_state) {
+    Defenses* defenses = &game_state->game_objects.defenses;
+    reserveDefenses(&game_state->game_objects);
+
+    int i = defenses->count++;
+    if (defenses->count > defenses->peak) {
+        defenses->peak = defenses->count;
+    }
+    recordDefenseChange(defenses, position, 1);
+    defenses->last_attacked[i] = game_state->time;
+    defenses->life[i] = 100;
+    defenses->position[i] = position;
+    defenses->sub_type[i] = type;
+
+    EntityHandle handle = allocateSlot(&game_state->game_objects, DEFENSE, i);
+    defenses->slot[i] = handle.slot;
+    return handle;
+}
+
+EntityHandle addProjectile(float x, float y, enum GeneralObjectType type, GameState* game_state) {
+    Projectiles* projectiles = &game_state->game_objects.projectiles;
+    reserveProjectiles(&game_state->game_objects);
+
+    int i = projectiles->count++;
+    if (projectiles->count > projectiles->peak) {
+        projectiles->peak = projectiles->count;
+    }
+    projectiles->position[i] = vec2(x, y);
+    projectiles->prev_position[i] = projectiles->position[i];
+    projectiles->sub_type[i] = type;
+
+    EntityHandle handle = allocateSlot(&game_state->game_objects, PROJECTILE, i);
+    projectiles->slot[i] = handle.slot;
+    return handle;
+}
+
+// the removed object's slot is released, the last one takes its place
+void removeEnemyAt(GameObjects* game_objects, int i) {
+    Enemies* enemies = &game_objects->enemies;
+    releaseSlot(&game_objects->slots, enemies->slot[i]);
+
+    int last = --enemies->count;
+    if (i == last) { return; }
+
+    enemies->position[i] = enemies->position[last];
+    enemies->prev_position[i] = enemies->prev_position[last];
+    enemies->waypoint[i] = enemies->waypoint[last];
+    enemies->speed[i] = enemies->speed[last];
+    enemies->life[i] = enemies->life[last];
+    enemies->row[i] = enemies->row[last];
+    enemies->sub_type[i] = enemies->sub_type[last];
+    enemies->slot[i] = enemies->slot[last];
+    game_objects->slots.slots[enemies->slot[i]].index = i;
+}
+
+void removeDefenseAt(GameObjects* game_objects, int i) {
+    Defenses* defenses = &game_objects->defenses;
+    releaseSlot(&game_objects->slots, defenses->slot[i]);
+    recordDefenseChange(defenses, defenses->position[i], -1);
+
+    int last = --defenses->count;
+    if (i == last) { return; }
+
+    defenses->position[i] = defenses->position[last];
+    defenses->last_attacked[i] = defenses->last_attacked[last];
+    defenses->life[i] = defenses->life[last];
+    defenses->sub_type[i] = defenses->sub_type[last];
+    defenses->slot[i] = defenses->slot[last];
+    game_objects->slots.slots[defenses->slot[i]].index = i;
+}
+
+void removeProjectileAt(GameObjects* game_objects, int i) {
+    Projectiles* projectiles = &game_objects->projectiles;
+    releaseSlot(&game_objects->slots, projectiles->slot[i]);
+
+    int last = --projectiles->count;
+    if (i == last) { return; }
+
+    projectiles->position[i] = projectiles->position[last];
+    projectiles->prev_position[i] = projectiles->prev_position[last];
+    projectiles->sub_type[i] = projectiles->sub_type[last];
+    projectiles->slot[i] = projectiles->slot[last];
+    game_objects->slots.slots[projectiles->slot[i]].index = i;
+}
+
+void removeGameObject(GameObjects* game_objects, EntityHandle handle) {
+    EntitySlots* slots = &game_objects->slots;
+    if (handle.slot >= (unsigned int) slots->count) { return; }
+
+    EntitySlot slot = slots->slots[handle.slot];
+    if (slot.generation != handle.generation) { return; }
+
+    if (slot.type == ENEMY) {
+        removeEnemyAt(game_objects, slot.index);
+    } else if (slot.type == DEFENSE) {
+        removeDefenseAt(game_objects, slot.index);
+    } else if (slot.type == PROJECTILE) {
+        removeProjectileAt(game_objects, slot.index);
+    }
+}
+
+void addToRow(RowIndex* row, float x, EntityHandle enemy) {
+    if (row->count >= row->capacity) {
+        row->capacity = row->capacity == 0 ? 16 : row->capacity * 2;
+        row->entries = realloc(row->entries, row->capacity * sizeof(RowEntry));
+    }
+    row->entries[row->count++] = (RowEntry) {.x=x, .enemy=enemy};
+}
+
+// rows keep their order between frames and enemies move only a bit per frame, so they are almost sorted already
+void sortRow(RowIndex* row) {
+    for (int i = 1; i < row->count; i++) {
+        RowEntry entry = row->entries[i];
+        int j = i - 1;
+        while (j >= 0 && row->entries[j].x > entry.x) {
+            row->entries[j + 1] = row->entries[j];
+            j--;
+        }
+        row->entries[j + 1] = entry;
+    }
+}
+
+int gridRow(GameState* game_state, float y) {
+    int row = (int) floorf(y);
+    if (row < 0 || row >= game_state->map.height) return -1;
+    return row;
+}
+
+void repairEnemyRows(GameState* game_state) {
+    GameObjects* game_objects = &game_state->game_objects;
+    Enemies* enemies = &game_objects->enemies;
+
+    // keep the surviving entries in last frame's order, with their new x
+    for (int r = 0; r < game_state->map.height; r++) {
+        RowIndex* row = &game_state->enemy_rows[r];
+        int kept = 0;
+        for (int i = 0; i < row->count; i++) {
+            int index = resolveHandle(game_objects, row->entries[i].enemy, ENEMY);
+            if (index == -1 || gridRow(game_state, enemies->position[index].y) != r) { continue; }
+            row->entries[i].x = enemies->position[index].x;
+            row->entries[kept++] = row->entries[i];
+        }
+        row->count = kept;
+    }
+
+    // then append the enemies that are new to their row
+    for (int e = 0; e < enemies->count; e++) {
+        int row = gridRow(game_state, enemies->position[e].y);
+        if (row == enemies->row[e]) { continue; }
+
+        enemies->row[e] = row;
+        if (row != -1) {
+            EntityHandle handle = {.slot=enemies->slot[e], .generation=game_objects->slots.slots[enemies->slot[e]].generation};
+            addToRow(&game_state->enemy_rows[row], enemies->position[e].x, handle);
+        }
+    }
+
+    for (int r = 0; r < game_state->map.height; r++) {
+        sortRow(&game_state->enemy_rows[r]);
+    }
+}
+
+int findRowCollision(RowIndex* row, Vector2 pp, GameState* game_state) {
+    // the first enemy (by x) for which ep.x + 1 > pp.x holds
+    int lo = 0;
+    int hi = row->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (row->entries[mid].x + 1 > pp.x) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    if (lo == row->count) return -1;
+    return resolveHandle(&game_state->game_objects, row->entries[lo].enemy, ENEMY);
+}
+
+int checkProjectileCollision(Vector2 pp, GameState* game_state) {
+    int collided_enemy = -1;
+
+    int row_id = gridRow(game_state, pp.y);
+    if (row_id != -1) {
+        collided_enemy = findRowCollision(&game_state->enemy_rows[row_id], pp, game_state);
+    }
+    return collided_enemy;
+}
+
+TerrainChunk* chunkAt(GameMap* map, float x, float y) {
+    int cx = Clamp(x, 0, map->width - 1);
+    int cy = Clamp(y, 0, map->height - 1);
+    return &map->chunks[(cy / CHUNK_SIZE) * map->chunks_x + cx / CHUNK_SIZE];
+}
+
+bool setupMap(GameState* game_state, int width, int height) {
+    // sand, one column to place on and the goal
+    if (width < 9 || width > GRID_MAX || height < 1 || height > GRID_MAX) {
+        fprintf(stderr, "map: %dx%d is outside of 9x1 to %dx%d\n", width, height, GRID_MAX, GRID_MAX);
+        return false;
+    }
+
+    GameMap* map = &game_state->map;
+    map->width = width;
+    map->height = height;
+    map->chunks_x = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    map->chunks_y = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    map->chunks = calloc(map->chunks_x * map->chunks_y, sizeof(TerrainChunk));
+    map->version++;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            enum Terrain terrain = TERRAIN_GRASS;
+            if (x >= width - 2) {
+                terrain = TERRAIN_PAVEMENT;
+            } else if (x <= 5) {
+                terrain = TERRAIN_SAND;
+            }
+            chunkAt(map, x, y)->terrain[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE] = terrain;
+        }
+    }
+
+    game_state->enemy_rows = calloc(height, sizeof(RowIndex));
+    initFlowField(&game_state->flow_field, width, height);
+    return true;
+}
+
+bool insideMap(GameMap* map, int x, int y) {
+    return x >= 0 && x < map->width && y >= 0 && y < map->height;
+}
+
+enum Terrain terrainAt(GameMap* map, int x, int y) {
+    return chunkAt(map, x, y)->terrain[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE];
+}
+
+bool canPlaceDefense(GameMap* map, int x, int y) {
+    return insideMap(map, x, y) && terrainAt(map, x, y) == TERRAIN_GRASS;
+}
+
+// a chunk is active while it or one of its neighbours has an enemy on it
+void countChunkEnemies(GameState* game_state) {
+    GameMap* map = &game_state->map;
+    Enemies* enemies = &game_state->game_objects.enemies;
+    int chunk_count = map->chunks_x * map->chunks_y;
+
+    for (int c = 0; c < chunk_count; c++) {
+        map->chunks[c].enemies = 0;
+        map->chunks[c].active = false;
+    }
+    for (int e = 0; e < enemies->count; e++) {
+        chunkAt(map, enemies->position[e].x, enemies->position[e].y)->enemies++;
+    }
+
+    for (int cy = 0; cy < map->chunks_y; cy++) {
+        for (int cx = 0; cx < map->chunks_x; cx++) {
+            if (map->chunks[cy * map->chunks_x + cx].enemies == 0) { continue; }
+            for (int ny = cy - 1; ny <= cy + 1; ny++) {
+                for (int nx = cx - 1; nx <= cx + 1; nx++) {
+                    if (nx < 0 || nx >= map->chunks_x || ny < 0 || ny >= map->chunks_y) { continue; }
+                    map->chunks[ny * map->chunks_x + nx].active = true;
+                }
+            }
+        }
+    }
+}
+
+void queueCommand(GameState* game_state, GameCommand command) {
+    CommandQueue* queue = &game_state->commands;
+    if (queue->count >= queue->capacity) {
+        queue->capacity = queue->capacity == 0 ? 64 : queue->capacity * 2;
+        queue->commands = realloc(queue->commands, queue->capacity * sizeof(GameCommand));
+    }
+
+    // after the commands of the same tick, never in front of applied ones
+    int i = queue->count;
+    while (i > queue->applied && queue->commands[i - 1].tick > command.tick) {
+        queue->commands[i] = queue->commands[i - 1];
+        i--;
+    }
+    queue->commands[i] = command;
+    queue->count++;
+}
+
+void applyCommands(GameState* game_state) {
+    CommandQueue* queue = &game_state->commands;
+    while (queue->applied < queue->count && queue->commands[queue->applied].tick <= game_state->tick) {
+        GameCommand command = queue->commands[queue->applied++];
+        // the same rule for every frontend, replays and scenarios can not place where the player can not
+        if (!canPlaceDefense(&game_state->map, command.x, command.y)) { continue; }
+        addDefense(vec2(command.x, command.y), command.type, game_state);
+    }
+}
+
+#define FNV_OFFSET 0xCBF29CE484222325ull
+#define FNV_PRIME 0x100000001B3ull
+
+unsigned long long hashBytes(unsigned long long hash, const void* data, size_t bytes) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < bytes; i++) {
+        hash = (hash ^ p[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+#define HASH_VALUE(hash, value) hashBytes(hash, &(value), sizeof(value))
+#define HASH_COLUMN(hash, column, count) hashBytes(hash, column, (count) * sizeof(*(column)))
+
+unsigned long long hashGameState(GameState* game_state) {
+    GameObjects* game_objects = &game_state->game_objects;
+    unsigned long long hash = FNV_OFFSET;
+
+    hash = HASH_VALUE(hash, game_state->map.width);
+    hash = HASH_VALUE(hash, game_state->map.height);
+    hash = HASH_VALUE(hash, game_state->tick);
+    hash = HASH_VALUE(hash, game_state->time);
+    hash = HASH_VALUE(hash, game_state->commands.applied);
+    hash = HASH_VALUE(hash, game_state->wave.next);
+    hash = HASH_VALUE(hash, game_state->stats);
+
+    Enemies* enemies = &game_objects->enemies;
+    hash = HASH_VALUE(hash, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->position, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->prev_position, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->waypoint, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->speed, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->life, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->row, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->sub_type, enemies->count);
+    hash = HASH_COLUMN(hash, enemies->slot, enemies->count);
+
+    Defenses* defenses = &game_objects->defenses;
+    hash = HASH_VALUE(hash, defenses->count);
+    hash = HASH_COLUMN(hash, defenses->position, defenses->count);
+    hash = HASH_COLUMN(hash, defenses->last_attacked, defenses->count);
+    hash = HASH_COLUMN(hash, defenses->life, defenses->count);
+    hash = HASH_COLUMN(hash, defenses->sub_type, defenses->count);
+    hash = HASH_COLUMN(hash, defenses->slot, defenses->count);
+
+    Projectiles* projectiles = &game_objects->projectiles;
+    hash = HASH_VALUE(hash, projectiles->count);
+    hash = HASH_COLUMN(hash, projectiles->position, projectiles->count);
+    hash = HASH_COLUMN(hash, projectiles->prev_position, projectiles->count);
+    hash = HASH_COLUMN(hash, projectiles->sub_type, projectiles->count);
+    hash = HASH_COLUMN(hash, projectiles->slot, projectiles->count);
+
+    // handles given out later depend on the slot generations and the free order
+    EntitySlots* slots = &game_objects->slots;
+    hash = HASH_VALUE(hash, slots->count);
+    hash = HASH_COLUMN(hash, slots->slots, slots->count);
+    hash = HASH_VALUE(hash, slots->free_count);
+    hash = HASH_COLUMN(hash, slots->free_slots, slots->free_count);
+
+    // the row index follows from the enemies, except for the order of enemies at the same x
+    for (int r = 0; r < game_state->map.height; r++) {
+        hash = HASH_VALUE(hash, game_state->enemy_rows[r].count);
+        hash = HASH_COLUMN(hash, game_state->enemy_rows[r].entries, game_state->enemy_rows[r].count);
+    }
+
+    return hash;
+}
+
+unsigned long long hashWave(EnemyWave* wave) {
+    unsigned long long hash = FNV_OFFSET;
+    hash = HASH_VALUE(hash, wave->count);
+    for (int s = 0; s < wave->count; s++) {
+        hash = HASH_VALUE(hash, wave->spawns[s].time);
+        hash = HASH_VALUE(hash, wave->spawns[s].row);
+        hash = HASH_VALUE(hash, wave->spawns[s].type);
+    }
+    return hash;
+}
+
+// enemies whose time has come enter at the start of their row
+void spawnWave(GameState* game_state) {
+    EnemyWave* wave = &game_state->wave;
+    while (wave->next < wave->count && wave->spawns[wave->next].time <= game_state->time) {
+        WaveSpawn spawn = wave->spawns[wave->next++];
+        addEnemy(vec2(0, spawn.row), spawn.type, game_state);
+    }
+}
+
+// most defenses presized for, on big maps only a fraction of the tiles is ever used
+#define LEVEL_PRESIZE_DEFENSES (16 * ENTITY_CHUNK)
+
+bool waveFitsMap(EnemyWave* wave, GameMap* map) {
+    for (int s = 0; s < wave->count; s++) {
+        if (wave->spawns[s].row >= map->height) {
+            fprintf(stderr, "wave: row %d is outside of the %d rows of the map\n", wave->spawns[s].row, map->height);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool startLevel(GameState* game_state) {
+    EnemyWave* wave = &game_state->wave;
+    if (!waveFitsMap(wave, &game_state->map)) { return false; }
+
+    // in the worst case no enemy dies before the last one enters.
+    // a defense can stand on every tile and has at most three projectiles in flight
+    int defenses = game_state->map.width * game_state->map.height;
+    if (defenses > LEVEL_PRESIZE_DEFENSES) defenses = LEVEL_PRESIZE_DEFENSES;
+    presizeGameObjects(game_state, wave->count, defenses, 3 * defenses);
+
+    spawnWave(game_state);
+    return true;
+}
+
+bool setupLevel(GameState* game_state, const char* wave_path) {
+    if (!loadWave(&game_state->wave, wave_path)) { return false; }
+    return startLevel(game_state);
+}
+
+bool setupLevelWithWave(GameState* game_state, const EnemyWave* wave) {
+    game_state->wave = (EnemyWave) {.count=wave->count};
+    game_state->wave.spawns = malloc(wave->count * sizeof(WaveSpawn));
+    memcpy(game_state->wave.spawns, wave->spawns, wave->count * sizeof(WaveSpawn));
+    return startLevel(game_state);
+}
+
+bool levelCleared(GameState* game_state) {
+    return game_state->wave.next == game_state->wave.count && game_state->game_objects.enemies.count == 0;
+}
+
+void updateEnemies(GameState* game_state, float delta_time) {
+    Enemies* enemies = &game_state->game_objects.enemies;
+    int count = enemies->count;
+
+    memcpy(enemies->prev_position, enemies->position, count * sizeof(Vector2));
+
+    // cell to cell along the flow field, a new waypoint is looked up whenever one is reached
+    FlowField* field = &game_state->flow_field;
+    for (int e = 0; e < count; e++) {
+        float step = enemies->speed[e] * delta_time;
+        Vector2 position = enemies->position[e];
+        Vector2 waypoint = enemies->waypoint[e];
+
+        while (step > 0) {
+            float left = Vector2Distance(position, waypoint);
+            if (left > step) {
+                position = Vector2MoveTowards(position, waypoint, step);
+                break;
+            }
+            position = waypoint;
+            step -= left;
+            if (waypoint.x >= game_state->map.width - 1) { break; }
+            waypoint = flowWaypoint(field, waypoint.x, waypoint.y);
+        }
+
+        enemies->position[e] = position;
+        enemies->waypoint[e] = waypoint;
+    }
+
+    // backwards, so the object swapped into a hole has been looked at already
+    for (int e = count - 1; e >= 0; e--) {
+        if (enemies->life[e] <= 0) {
+            game_state->stats.enemies_killed++;
+            removeEnemyAt(&game_state->game_objects, e);
+        } else if (enemies->position[e].x >= game_state->map.width - 1) {
+            game_state->stats.enemies_leaked++;
+            removeEnemyAt(&game_state->game_objects, e);
+        }
+    }
+
+    countChunkEnemies(game_state);
+    repairEnemyRows(game_state);
+}
+
+void updateDefenses(GameState* game_state) {
+    Defenses* defenses = &game_state->game_objects.defenses;
+    double now = game_state->time;
+
+    for (int d = 0; d < defenses->count; d++) {
+        // far from every enemy a defense holds its charge, so large maps only simulate where the wave is
+        if (!chunkAt(&game_state->map, defenses->position[d].x, defenses->position[d].y)->active) { continue; }
+
+        // TODO: projectile generation should be based on charging a certain bar which would be higher/lower depending on the effectiveness of the projectile
+        double time_passed = now - defenses->last_attacked[d];
+
+        if (time_passed < 4.0) { continue; }
+
+        Vector2 p = defenses->position[d];
+        addProjectile(p.x-1, p.y, PROJECTILE_TYPE_1, game_state);
+        defenses->last_attacked[d] = now;
+        game_state->stats.projectiles_fired++;
+    }
+}
+
+// only the first moving_count projectiles existed before this update, the rest start moving on the next one
+void updateProjectiles(GameState* game_state, float delta_time, int moving_count) {
+    Projectiles* projectiles = &game_state->game_objects.projectiles;
+    Enemies* enemies = &game_state->game_objects.enemies;
+
+    memcpy(projectiles->prev_position, projectiles->position, moving_count * sizeof(Vector2));
+
+    for (int p = 0; p < moving_count; p++) {
+        // TODO: projectiles will move with different speeds
+        projectiles->position[p].x -= 2 * delta_time;
+    }
+
+    // one trace event for all the queries, one each would fill the trace within seconds of a big wave
+    double trace_started = traceBegin();
+    // backwards, so only objects that were handled already or have just spawned are swapped into a hole
+    for (int p = moving_count - 1; p >= 0; p--) {
+        int collided_enemy = checkProjectileCollision(projectiles->position[p], game_state);
+
+        if (collided_enemy != -1) {
+            enemies->life[collided_enemy] -= 40;
+        }
+        if (collided_enemy != -1 || projectiles->position[p].x < 0) {
+            removeProjectileAt(&game_state->game_objects, p);
+        }
+    }
+    traceEnd("checkProjectileCollisions", trace_started);
+}
+
+void update(GameState* game_state, float delta_time) {
+    applyCommands(game_state);
+    game_state->time += delta_time;
+    spawnWave(game_state);
+
+    profileBegin(PROFILE_UPDATE);
+
+    // only placing or removing a defense changes the routes
+    FlowField* field = &game_state->flow_field;
+    if (!field->built || field->defenses_version != game_state->game_objects.defenses.version) {
+        profileBegin(PROFILE_UPDATE_FLOW_FIELD);
+        updateFlowField(field, &game_state->game_objects.defenses);
+        profileEnd(PROFILE_UPDATE_FLOW_FIELD);
+    }
+
+    int moving_count = game_state->game_objects.projectiles.count;
+
+    profileBegin(PROFILE_UPDATE_ENEMIES);
+    updateEnemies(game_state, delta_time);
+    profileEnd(PROFILE_UPDATE_ENEMIES);
+
+    profileBegin(PROFILE_UPDATE_DEFENSES);
+    updateDefenses(game_state);
+    profileEnd(PROFILE_UPDATE_DEFENSES);
+
+    profileBegin(PROFILE_UPDATE_PROJECTILES);
+    updateProjectiles(game_state, delta_time, moving_count);
+    profileEnd(PROFILE_UPDATE_PROJECTILES);
+
+    profileEnd(PROFILE_UPDATE);
+    game_state->tick++;
+
+    profileCounterSet(COUNTER_ENEMIES, game_state->game_objects.enemies.count);
+    profileCounterSet(COUNTER_DEFENSES, game_state->game_objects.defenses.count);
+    profileCounterSet(COUNTER_PROJECTILES, game_state->game_objects.projectiles.count);
+    profileCounterAdd(COUNTER_SIM_TICKS, 1);
+    profileCounterSet(COUNTER_COMMITTED_KB, game_state->game_objects.arena.committed / 1024);
+}
+
+int gameObjectCount(GameState* game_state) {
+    GameObjects* objects = &game_state->game_objects;
+    return objects->enemies.count + objects->defenses.count + objects->projectiles.count;
+}
+
+void freeGameState(GameState* game_state) {
+    arenaFree(&game_state->game_objects.arena);
+    game_state->game_objects = (GameObjects) {0};
+
+    for (int r = 0; r < game_state->map.height; r++) {
+        free(game_state->enemy_rows[r].entries);
+    }
+    free(game_state->enemy_rows);
+    game_state->enemy_rows = NULL;
+
+    free(game_state->map.chunks);
+    game_state->map = (GameMap) {0};
+    freeFlowField(&game_state->flow_field);
+
+    free(game_state->commands.commands);
+    game_state->commands = (CommandQueue) {0};
+    freeWave(&game_state->wave);
+}
@@ -0,0 +1,285 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdbool.h>
+#include "raylib.h"
+#include "arena.h"
+
+// grid dimensions are picked when the map is set up, up to GRID_MAX on a side
+#define GRID_DEFAULT_SIZE 25
+#define GRID_MAX 1024
+// side of a terrain chunk in cells, the renderer caches and culls whole chunks
+#define CHUNK_SIZE 16
+
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 32
+#define VERTICAL_OFFSET 100.0
+
+// most objects of one kind a game can hold, only address space is taken for them up front
+#define ENTITY_MAX (1 << 20)
+// stores grow by this many objects at a time
+#define ENTITY_CHUNK 1024
+
+// the simulation always advances in steps of SIM_DT, independent of the display rate
+#ifndef SIM_TICK_RATE
+#define SIM_TICK_RATE 30
+#endif
+#define SIM_DT (1.0f / SIM_TICK_RATE)
+
+enum GeneralObjectType {
+    ENEMY_TYPE_1,
+    ENEMY_TYPE_2,
+    DEFENDER_TYPE_1,
+    DEFENDER_TYPE_2,
+    PROJECTILE_TYPE_1,
+};
+
+enum GameObjectType {
+    ENEMY,
+    DEFENSE,
+    PROJECTILE,
+};
+
+// stays valid across frames, resolves to nothing once the object is removed
+typedef struct EntityHandle {
+    unsigned int slot;
+    unsigned int generation; // 0 is never handed out, so a zeroed handle is empty
+} EntityHandle;
+
+typedef struct EntitySlot {
+    enum GameObjectType type;
+    int index; // into the store of its type
+    unsigned int generation;
+} EntitySlot;
+
+typedef struct EntitySlots {
+    EntitySlot* slots;
+    int count;
+    int capacity;
+    int* free_slots; // released slots, reused before new ones are made
+    int free_count;
+} EntitySlots;
+
+
+// game objects are stored as structure of arrays, one dense store per kind.
+// the update loops only touch the columns they need. removal swaps the last
+// object into the hole, the slot table keeps the handles pointing at the right index.
+// every column lives in the arena at a fixed address and grows in place.
+typedef struct Enemies {
+    Vector2* position;
+    Vector2* prev_position; // position before the last update, for interpolated drawing
+    Vector2* waypoint; // center of the cell it walks to, the flow field picks the next one
+    float* speed; // grid cells per second
+    float* life;
+    int* row; // enemy_rows entry this enemy is indexed under, -1 if none
+    enum GeneralObjectType* sub_type;
+    unsigned int* slot; // owning entry of the slot table
+    int count;
+    int capacity; // committed
+    int peak;
+} Enemies;
+
+// a defense placed (+1) or removed (-1) on a cell, for the flow field to catch up with
+typedef struct DefenseChange {
+    int x;
+    int y;
+    int delta;
+} DefenseChange;
+
+#define DEFENSE_CHANGES_MAX 64
+
+typedef struct Defenses {
+    Vector2* position;
+    double* last_attacked;
+    float* life;
+    enum GeneralObjectType* sub_type;
+    unsigned int* slot; // owning entry of the slot table
+    int count;
+    int capacity; // committed
+    int peak;
+    unsigned int version; // bumped whenever a defense is placed or removed
+    // placed and removed since the flow field last caught up, so it only looks at those cells.
+    // past DEFENSE_CHANGES_MAX only changes_overflowed is set and the field is built from scratch
+    DefenseChange changes[DEFENSE_CHANGES_MAX];
+    int change_count;
+    bool changes_overflowed;
+} Defenses;
+
+typedef struct Projectiles {
+    Vector2* position;
+    Vector2* prev_position;
+    enum GeneralObjectType* sub_type;
+    unsigned int* slot; // owning entry of the slot table
+    int count;
+    int capacity; // committed
+    int peak;
+} Projectiles;
+
+typedef struct GameObjects {
+    Enemies enemies;
+    Defenses defenses;
+    Projectiles projectiles;
+    EntitySlots slots;
+    Arena arena; // set up by the first add* or presizeGameObjects()
+} GameObjects;
+
+// enemies of a single grid row, ordered by x
+typedef struct RowEntry {
+    float x;
+    EntityHandle enemy;
+} RowEntry;
+
+typedef struct RowIndex {
+    RowEntry* entries;
+    int count;
+    int capacity;
+} RowIndex;
+
+// a player action, applied by update() at the start of the given tick.
+// input goes through these so a run only depends on the map, the wave and the commands
+typedef struct GameCommand {
+    long tick;
+    int x;
+    int y;
+    enum GeneralObjectType type; // defense to place on the cell
+} GameCommand;
+
+typedef struct CommandQueue {
+    GameCommand* commands; // ordered by tick, applied ones are kept as the run's input log
+    int count;
+    int capacity;
+    int applied;
+} CommandQueue;
+
+// one enemy of a wave, the lines of a wave file are expanded into these
+typedef struct WaveSpawn {
+    double time; // simulation time it enters at
+    int row;
+    enum GeneralObjectType type;
+} WaveSpawn;
+
+// every spawn of the level ordered by time. update() only looks at the
+// ones that are due, so a tick costs as much as the enemies it spawns
+typedef struct EnemyWave {
+    WaveSpawn* spawns;
+    int count;
+    int next; // first spawn that has not entered yet
+} EnemyWave;
+
+// outcome of a run so far
+typedef struct GameStats {
+    int enemies_killed;
+    int enemies_leaked; // reached the last column, they leave the grid there
+    int projectiles_fired;
+} GameStats;
+
+enum Terrain {
+    TERRAIN_SAND, // where enemies enter
+    TERRAIN_GRASS, // the only terrain defenses can be placed on
+    TERRAIN_PAVEMENT, // the goal the enemies walk to
+};
+
+typedef struct TerrainChunk {
+    unsigned char terrain[CHUNK_SIZE * CHUNK_SIZE]; // enum Terrain, row by row
+    int enemies; // on the chunk after the last enemy update
+    bool active; // defenses are only updated on active chunks
+} TerrainChunk;
+
+// the ground of the level, chunks cover the grid row by row and the last ones may stick out of it
+typedef struct GameMap {
+    int width; // cells
+    int height;
+    int chunks_x;
+    int chunks_y;
+    TerrainChunk* chunks;
+    unsigned int version; // bumped when the terrain changes, so renderers know to rebuild their caches
+} GameMap;
+
+// cost to reach the goal column from every cell, shared by all enemies.
+// cells are indexed y * width + x
+typedef struct FlowField {
+    int width;
+    int height;
+    float* distance; // steps, INFINITY when cut off
+    int* next; // neighbour to step to, -1 on the goal column or when cut off
+    int* blockers; // defenses standing on the cell, enemies walk around them
+    bool built;
+    unsigned int defenses_version; // of the defenses it is up to date with, update() repairs it when they change
+    int last_fix_cells; // cells solved again by the last repair or build
+    int repairs;
+    int full_rebuilds;
+} FlowField;
+
+typedef struct GameState {
+    Vector2 mouse_position; // ui only, not part of the simulation
+    GameObjects game_objects;
+    GameMap map;
+    RowIndex* enemy_rows; // one per grid row, repaired by update() as enemies move
+    CommandQueue commands;
+    EnemyWave wave;
+    FlowField flow_field;
+    GameStats stats;
+    double time; // simulation clock, advanced only by update()
+    long tick; // updates run so far
+} GameState;
+
+extern int screen_width;
+extern int screen_height;
+
+Vector2 vec2(float x, float y);
+Vector2 toIso(Vector2 coord, bool translate_by_half_width);
+Vector2 fromIso(Vector2 screen, bool snap_to_grid);
+
+EntityHandle addEnemy(Vector2 position, enum GeneralObjectType type, GameState* game_state);
+EntityHandle addDefense(Vector2 position, enum GeneralObjectType type, GameState* game_state);
+EntityHandle addProjectile(float x, float y, enum GeneralObjectType type, GameState* game_state);
+// index into the store of the given type, -1 if the object is gone or of another type
+int resolveHandle(GameObjects* game_objects, EntityHandle handle, enum GameObjectType type);
+void removeGameObject(GameObjects* game_objects, EntityHandle handle);
+// index of the enemy hit by the projectile, -1 if none
+int checkProjectileCollision(Vector2 projectile_position, GameState* game_state);
+
+// commits room for the expected peak counts, so spawning never has to grow the stores mid-frame
+void presizeGameObjects(GameState* game_state, int enemies, int defenses, int projectiles);
+// prints how much memory the stores reserved, committed and used at most
+void reportAllocations(GameState* game_state);
+
+// sizes the grid and lays out the default terrain, sand on the left and the goal on the right.
+// returns false if the size is out of range
+bool setupMap(GameState* game_state, int width, int height);
+enum Terrain terrainAt(GameMap* map, int x, int y);
+// chunk holding the cell, positions off the map are clamped to its edge
+TerrainChunk* chunkAt(GameMap* map, float x, float y);
+bool insideMap(GameMap* map, int x, int y);
+// defenses can only be placed on grass
+bool canPlaceDefense(GameMap* map, int x, int y);
+
+// the simulation draws no random numbers, runs with the same map, wave and commands
+// give the same state at every tick.
+// commands for a tick that has passed already are applied on the next update,
+// placements canPlaceDefense() refuses are dropped
+void queueCommand(GameState* game_state, GameCommand command);
+// 64 bit fnv-1a of every simulated value, equal hashes mean equal states
+unsigned long long hashGameState(GameState* game_state);
+// of every spawn, the same for waves that play out the same whatever file they came from
+unsigned long long hashWave(EnemyWave* wave);
+
+// the wave setupLevel() loads unless told otherwise
+#define WAVE_DEFAULT "./waves/level_1.wave"
+
+// every spawn row is on the map, reports the first one that is not
+bool waveFitsMap(EnemyWave* wave, GameMap* map);
+// loads the wave and spawns its enemies that are due at time 0, on the map set up before.
+// returns false if the wave can not be read or does not fit the map
+bool setupLevel(GameState* game_state, const char* wave_path);
+// same with a wave that is loaded already, the state gets its own copy
+bool setupLevelWithWave(GameState* game_state, const EnemyWave* wave);
+// every enemy of the wave has entered and none is left
+bool levelCleared(GameState* game_state);
+// advances the simulation by delta_time seconds, does not use the window or the gpu.
+// the game always passes SIM_DT, any other step makes the results depend on the caller
+void update(GameState* game_state, float delta_time);
+int gameObjectCount(GameState* game_state);
+void freeGameState(GameState* game_state);
+
+#endif
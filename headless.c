@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "input_log.h"
+#include "profiler.h"
+#include "trace.h"
+
+// runs the simulation without a window, gpu or raylib at all.
+// --replay runs the commands of an input log as fast as possible, for the ticks it recorded unless --ticks is given.
+// --hash-log writes the state hash after every tick, --verify compares a run against such a log
+// usage: game-headless [--ticks N] [--dt SECONDS] [--wave FILE] [--grid WxH] [--defense X,Y]... [--record FILE] [--replay FILE] [--hash-log FILE] [--verify FILE] [--profile] [--trace FILE] [--alloc-stats]
+
+int main(int argc, char** argv) {
+    int ticks = 3600;
+    bool ticks_given = false;
+    char* wave_path = WAVE_DEFAULT;
+    char* record_path = NULL;
+    char* replay_path = NULL;
+    char* trace_path = NULL;
+    bool alloc_stats = false;
+    float delta_time = SIM_DT;
+    FILE* hash_log = NULL;
+    FILE* verify_log = NULL;
+    int grid_width = GRID_DEFAULT_SIZE;
+    int grid_height = GRID_DEFAULT_SIZE;
+
+    GameState game_state = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = atoi(argv[++i]);
+            ticks_given = true;
+        } else if (strcmp(argv[i], "--dt") == 0 && i + 1 < argc) {
+            delta_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--wave") == 0 && i + 1 < argc) {
+            wave_path = argv[++i];
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &grid_width, &grid_height) != 2) {
+                fprintf(stderr, "invalid grid size: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--hash-log") == 0 && i + 1 < argc) {
+            hash_log = fopen(argv[++i], "w");
+            if (hash_log == NULL) {
+                fprintf(stderr, "could not open %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) {
+            verify_log = fopen(argv[++i], "r");
+            if (verify_log == NULL) {
+                fprintf(stderr, "could not open %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--defense") == 0 && i + 1 < argc) {
+            int x, y;
+            if (sscanf(argv[++i], "%d,%d", &x, &y) != 2 || x < 0 || y < 0) {
+                fprintf(stderr, "invalid defense position: %s\n", argv[i]);
+                return 1;
+            }
+            queueCommand(&game_state, (GameCommand) {.tick=0, .x=x, .y=y, .type=DEFENDER_TYPE_1});
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profilerEnable(true);
+        } else if (strcmp(argv[i], "--alloc-stats") == 0) {
+            alloc_stats = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+            traceStart();
+        } else {
+            fprintf(stderr, "usage: %s [--ticks N] [--dt SECONDS] [--wave FILE] [--grid WxH] [--defense X,Y]... [--record FILE] [--replay FILE] [--hash-log FILE] [--verify FILE] [--profile] [--trace FILE] [--alloc-stats]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!setupMap(&game_state, grid_width, grid_height) || !setupLevel(&game_state, wave_path)) {
+        freeGameState(&game_state);
+        return 1;
+    }
+    // after the setup, the log is checked against the grid and wave of this run
+    if (replay_path != NULL) {
+        long recorded_ticks = loadInputLog(&game_state, replay_path);
+        if (recorded_ticks == -1) {
+            fprintf(stderr, "could not replay input log %s\n", replay_path);
+            freeGameState(&game_state);
+            return 1;
+        }
+        if (!ticks_given) {
+            ticks = recorded_ticks;
+        }
+    }
+
+    long diverged_tick = -1;
+    double started = profilerNow();
+    for (int t = 0; t < ticks; t++) {
+        update(&game_state, delta_time);
+        profileFrameEnd();
+
+        if (hash_log == NULL && verify_log == NULL) { continue; }
+        unsigned long long hash = hashGameState(&game_state);
+        if (hash_log != NULL) {
+            fprintf(hash_log, "%ld %016llx\n", game_state.tick, hash);
+        }
+        if (verify_log != NULL && diverged_tick == -1) {
+            long expected_tick;
+            unsigned long long expected_hash;
+            if (fscanf(verify_log, "%ld %llx", &expected_tick, &expected_hash) != 2) {
+                fprintf(stderr, "verify: log ends before tick %ld\n", game_state.tick);
+                diverged_tick = game_state.tick;
+            } else if (expected_tick != game_state.tick || expected_hash != hash) {
+                fprintf(stderr, "verify: diverged at tick %ld, expected %016llx got %016llx\n", game_state.tick, expected_hash, hash);
+                diverged_tick = game_state.tick;
+            }
+        }
+    }
+    double elapsed = profilerNow() - started;
+
+    if (hash_log != NULL) {
+        fclose(hash_log);
+    }
+    if (record_path != NULL && !saveInputLog(&game_state, record_path)) {
+        fprintf(stderr, "could not write input log to %s\n", record_path);
+    }
+    if (verify_log != NULL) {
+        fclose(verify_log);
+        if (diverged_tick == -1) {
+            printf("verify: %d ticks match\n", ticks);
+        }
+    }
+
+    if (trace_path != NULL) {
+        traceStop();
+        if (!traceWrite(trace_path)) {
+            fprintf(stderr, "could not write trace to %s\n", trace_path);
+        }
+        freeTrace();
+    }
+
+    printf("ticks: %d\n", ticks);
+    printf("sim time: %.3fs\n", game_state.time);
+    printf("wall time: %.3fs\n", elapsed);
+    printf("ticks/s: %.0f\n", elapsed > 0 ? ticks / elapsed : 0);
+    printf("enemies: %d\n", game_state.game_objects.enemies.count);
+    printf("defenses: %d\n", game_state.game_objects.defenses.count);
+    printf("projectiles: %d\n", game_state.game_objects.projectiles.count);
+    printf("killed: %d\n", game_state.stats.enemies_killed);
+    printf("leaked: %d\n", game_state.stats.enemies_leaked);
+    printf("fired: %d\n", game_state.stats.projectiles_fired);
+
+    if (profilerEnabled()) {
+        printf("\nlast %d ticks (ms)      min       avg       p99\n", PROFILE_HISTORY);
+        for (int z = PROFILE_UPDATE; z <= PROFILE_UPDATE_PROJECTILES; z++) {
+            ProfileStats stats = profileZoneStats(z);
+            printf("%*s%-*s %9.4f %9.4f %9.4f\n", PROFILE_ZONE_DEPTH[z] * 2, "", 16 - PROFILE_ZONE_DEPTH[z] * 2, PROFILE_ZONE_NAMES[z], stats.min, stats.avg, stats.p99);
+        }
+
+        FlowField* field = &game_state.flow_field;
+        printf("\nflow field: %d repairs, %d full rebuilds, last fix %ld cells in %ldus\n", field->repairs, field->full_rebuilds, profileCounterValue(COUNTER_FLOW_FIX_CELLS), profileCounterValue(COUNTER_FLOW_FIX_US));
+    }
+
+    if (alloc_stats) {
+        printf("\n");
+        reportAllocations(&game_state);
+    }
+
+    freeGameState(&game_state);
+    return diverged_tick == -1 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include "input_log.h"
+
+bool saveInputLog(GameState* game_state, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) { return false; }
+
+    fprintf(file, "grid %dx%d\n", game_state->map.width, game_state->map.height);
+    fprintf(file, "wave %016llx\n", hashWave(&game_state->wave));
+    fprintf(file, "ticks %ld\n", game_state->tick);
+
+    CommandQueue* queue = &game_state->commands;
+    for (int i = 0; i < queue->count; i++) {
+        GameCommand command = queue->commands[i];
+        fprintf(file, "%ld %d %d %d\n", command.tick, command.x, command.y, command.type);
+    }
+
+    return fclose(file) == 0;
+}
+
+long loadInputLog(GameState* game_state, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) { return -1; }
+
+    int width, height;
+    unsigned long long wave_hash;
+    long ticks;
+    if (fscanf(file, " grid %dx%d wave %llx ticks %ld", &width, &height, &wave_hash, &ticks) != 4) {
+        fprintf(stderr, "replay: %s is not an input log\n", path);
+        fclose(file);
+        return -1;
+    }
+    // any other map or wave diverges from the first tick on
+    if (width != game_state->map.width || height != game_state->map.height) {
+        fprintf(stderr, "replay: %s was recorded on a %dx%d grid, not %dx%d\n", path, width, height, game_state->map.width, game_state->map.height);
+        fclose(file);
+        return -1;
+    }
+    if (wave_hash != hashWave(&game_state->wave)) {
+        fprintf(stderr, "replay: %s was recorded with another wave\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    GameCommand command;
+    int type;
+    while (fscanf(file, "%ld %d %d %d", &command.tick, &command.x, &command.y, &type) == 4) {
+        command.type = type;
+        queueCommand(game_state, command);
+    }
+
+    bool complete = feof(file);
+    fclose(file);
+    return complete ? ticks : -1;
+}
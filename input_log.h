@@ -0,0 +1,21 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// the commands of a run plus what they were played on, as a text file:
+//   grid <width>x<height>
+//   wave <hashWave() of the wave>
+//   ticks <ticks the run lasted>
+//   <tick> <x> <y> <type>   (one line per placement)
+// together with the same wave file this is all it takes to run the game again exactly
+
+// writes every queued command, returns false when the file could not be written
+bool saveInputLog(GameState* game_state, const char* path);
+// queues the commands of the log on a state whose map and level are set up already.
+// returns the recorded number of ticks, or -1 when the file can not be read or was
+// recorded on another grid or wave
+long loadInputLog(GameState* game_state, const char* path);
+
+#endif
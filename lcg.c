@@ -0,0 +1,15 @@
+#include "lcg.h"
+
+// numerical recipes constants, the top 24 bits are the usable ones
+unsigned int lcgNext(unsigned int* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+int lcgInt(unsigned int* seed, int max) {
+    return lcgNext(seed) % max;
+}
+
+float lcgFloat(unsigned int* seed, float max) {
+    return lcgNext(seed) / (float) (1 << 24) * max;
+}
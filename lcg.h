@@ -0,0 +1,12 @@
+#ifndef LCG_H
+#define LCG_H
+
+// the numbers bench, batch and render bench scatter objects with. the same seed gives
+// the same numbers on every machine, the simulation itself uses no randomness
+unsigned int lcgNext(unsigned int* seed);
+// 0 to max - 1
+int lcgInt(unsigned int* seed, int max);
+// 0 up to but not including max
+float lcgFloat(unsigned int* seed, float max);
+
+#endif
@@ -1,356 +1,397 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "raylib.h"
 #include "raymath.h"
-
-#define GRID_SIZE 25
-
-#define TILE_WIDTH 64
-#define TILE_HEIGHT 32
-#define VERTICAL_OFFSET 100.0
-
-enum GeneralObjectType {
-    ENEMY_TYPE_1,
-    ENEMY_TYPE_2,
-    DEFENDER_TYPE_1,
-    DEFENDER_TYPE_2,
-    PROJECTILE_TYPE_1,
-};
-
-enum GameObjectType {
-    ENEMY,
-    DEFENSE,
-    PROJECTILE,
-};
-
-typedef struct Enemy {
-    Vector2 start;
-    Vector2 target;
-    Vector2 current_iso_coord;
-    float move_pct; // progress till dest
-    float life;
-} Enemy;
-
-typedef struct Defense {
-    double last_attacked;
-    float life;
-} Defense;
-
-typedef union GameObjectValue {
-    Enemy enemy;
-    Defense defense;
-};
-
-typedef struct GameObject {
-    union GameObjectValue game_object;
-    Vector2 position;
-    enum GameObjectType type;
-    enum GeneralObjectType sub_type;
-    int is_active;
-} GameObject;
-
-typedef struct GameObjects {
-    GameObject* objects;
-    int count;
-    int capacity;
-} GameObjects;
-
-typedef struct GameState {
-    Vector2 mouse_position;
-    GameObjects game_objects;
-
-} GameState;
-
-Vector2 vec2(float x, float y) {
-    return (Vector2) {.x=x, .y=y};
-}
-
-void resize(GameObjects* container) {
-    if (container->count >= container->capacity) {
-        if (container->capacity == 0) {
-            container->capacity = 256;
-        } else {
-            container->capacity *= 2;
-        }
-        container->objects = realloc(container->objects, container->capacity * sizeof(GameObject));
-    }
-}
+#include "game.h"
+#include "draw_order.h"
+#include "viewport.h"
+#include "scratch.h"
+#include "input_log.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "asset_loader.h"
+#include "profiler.h"
+#include "trace.h"
+
+// ground chunks kept rendered at once, each a 1056x544 texture with a depth buffer (about 4.6 MB).
+// a 2560x1440 screen shows up to 35 chunks at zoom 1, more zoomed out. those past the cache are drawn tile by tile
+#define GROUND_CHUNK_CACHE 32
+
+// the ground tiles of one terrain chunk, drawn once into a texture
+typedef struct GroundChunk {
+    RenderTexture2D layer;
+    int chunk; // index into the map's chunks, -1 while the texture holds nothing
+    unsigned int map_version; // of the terrain it was drawn from
+    unsigned long last_used; // frame
+} GroundChunk;
 
 /* global variables start */
-int screen_width;
-int screen_height;
-Texture2D ground_grass_texture;
-Texture2D ground_pavement_texture;
-Texture2D ground_sand_texture;
-Texture2D mouseover_texture;
-Texture2D white_full_overlay_texture;
-Texture2D white_half_overlay_texture;
-Texture2D GAME_OBJECT_TEXTURES[10];
+Atlas atlas;
+SpriteBatch sprite_batch; // the game objects, the ground goes through raylib
+DrawOrder draw_order;
+Camera2D camera = {.zoom=1};
+GroundChunk ground_chunks[GROUND_CHUNK_CACHE];
+unsigned long frame_count = 0;
+bool show_profiler = false;
+char* record_path = NULL; // input log written on exit
+long replay_end = 0; // tick the replayed log ends at, placing is disabled till then
+float replay_speed = 1;
+double launched = 0; // when main() started, 0 once the first frame is on screen
 /* global variables end */
 
-Vector2 toIso(Vector2 coord, bool translate_by_half_width) {
-    // calculate screen coordinates
-    float x = (coord.x - coord.y) * (TILE_WIDTH / 2);
-    float y = (coord.x + coord.y) * (TILE_HEIGHT / 2);
+// screen pixels per second
+#define CAMERA_PAN_SPEED 800
 
-    // some translation
-    x -= (TILE_WIDTH / 2) * translate_by_half_width;
-    x += screen_width / 2;
-    y += VERTICAL_OFFSET;
+// drag with the right mouse button or the arrow keys to pan, the wheel zooms around the cursor
+void moveCamera(void) {
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+        camera.target = Vector2Subtract(camera.target, Vector2Scale(GetMouseDelta(), 1 / camera.zoom));
+    }
 
-    return vec2(x, y);
+    Vector2 direction = {
+        IsKeyDown(KEY_RIGHT) - IsKeyDown(KEY_LEFT),
+        IsKeyDown(KEY_DOWN) - IsKeyDown(KEY_UP),
+    };
+    camera.target = Vector2Add(camera.target, Vector2Scale(direction, CAMERA_PAN_SPEED * GetFrameTime() / camera.zoom));
+
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0) {
+        // the point under the cursor stays there
+        camera.target = GetScreenToWorld2D(GetMousePosition(), camera);
+        camera.offset = GetMousePosition();
+        camera.zoom = Clamp(camera.zoom * (1 + 0.1f * wheel), CAMERA_MIN_ZOOM, CAMERA_MAX_ZOOM);
+    }
 }
 
-Vector2 fromIso(Vector2 screen, bool snap_to_grid) {
-    screen.x -= screen_width / 2;
-    screen.y -= VERTICAL_OFFSET;
-
-    float x = (screen.x / (TILE_WIDTH / 2) + screen.y / (TILE_HEIGHT / 2)) / 2;
-    float y = (screen.y / (TILE_HEIGHT / 2) -(screen.x / (TILE_WIDTH / 2))) / 2;
+void grabUserInput(GameState* game_state) {
+    moveCamera();
+    game_state->mouse_position = fromIso(GetScreenToWorld2D(GetMousePosition(), camera), true);
 
-    if (snap_to_grid) {
-        x = floorf(x);
-        y = floorf(y);
+    // a replay feeds the placements from its log
+    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && game_state->tick >= replay_end) {
+        int mpx = game_state->mouse_position.x;
+        int mpy = game_state->mouse_position.y;
+        if (canPlaceDefense(&game_state->map, mpx, mpy)) {
+            // placed by the next update, so it lands on a tick and not on a frame
+            queueCommand(game_state, (GameCommand) {.tick=game_state->tick, .x=mpx, .y=mpy, .type=DEFENDER_TYPE_1});
+        }
     }
-
-    return vec2(x, y);
 }
 
-int compareGameObjects(const void* a, const void* b) {
-    GameObject* o1 = ( (GameObject*) a );
-    GameObject* o2 = ( (GameObject*) b );
-
-    if (!o1->is_active) return 1;
-    if (!o2->is_active) return -1;
-
-    Vector2 p1 = o1->position;
-    Vector2 p2 = o2->position;
+const enum SpriteId TERRAIN_SPRITES[] = {
+    [TERRAIN_SAND] = SPRITE_GROUND_SAND,
+    [TERRAIN_GRASS] = SPRITE_GROUND_GRASS,
+    [TERRAIN_PAVEMENT] = SPRITE_GROUND_PAVEMENT,
+};
 
-    if (p1.y < p2.y) {
-        return -1;
-    } else if (p1.y > p2.y) {
-        return 1;
-    } 
-    
-    return p1.x - p2.x;
+enum SpriteId groundSprite(GameMap* map, int x, int y) {
+    return TERRAIN_SPRITES[terrainAt(map, x, y)];
 }
 
-void addEnemy(Vector2 position, enum GeneralObjectType type, GameState* game_state) {
-    resize(&game_state->game_objects);
-
-    GameObject* game_object = &(game_state->game_objects.objects[game_state->game_objects.count]); 
-    game_object->type = ENEMY;
-
-    // movement related parameters
-    game_object->game_object.enemy.start = toIso(vec2(0, position.y), false);
-    game_object->game_object.enemy.target = toIso(vec2(GRID_SIZE-1, position.y), false);
-    game_object->game_object.enemy.move_pct = 0.0;
-    game_object->game_object.enemy.life = 100; // will be different by the enemy type
-
-    game_object->position = position;
-    game_object->sub_type = type;
-    game_object->is_active = 1;
-
-    game_state->game_objects.objects[game_state->game_objects.count++] = *game_object;
+// top left corner of a chunk's ground on the screen, every chunk covers the same area
+// so the ones sticking out of the grid are laid out like the rest
+Vector2 groundChunkOrigin(int cx, int cy) {
+    int x = cx * CHUNK_SIZE;
+    int y = cy * CHUNK_SIZE;
+    return vec2(toIso(vec2(x, y + CHUNK_SIZE - 1), true).x, toIso(vec2(x, y), true).y);
 }
 
-void addDefense(Vector2 position, enum GeneralObjectType type, GameState* game_state) {
-    resize(&game_state->game_objects);
-
-    GameObject* game_object = &(game_state->game_objects.objects[game_state->game_objects.count]); 
-    game_object->type = DEFENSE;
-
-    game_object->game_object.defense.last_attacked = GetTime();
-    game_object->position = position;
-    game_object->sub_type = type;
-    game_object->is_active = 1;
-    
-    game_state->game_objects.objects[game_state->game_objects.count++] = *game_object;
+Vector2 groundChunkSize(void) {
+    return vec2((2 * CHUNK_SIZE - 1) * (TILE_WIDTH / 2) + TILE_WIDTH, 2 * (CHUNK_SIZE - 1) * (TILE_HEIGHT / 2) + TILE_WIDTH);
 }
 
-void addProjectile(float x, float y, enum GeneralObjectType type, GameState* game_state) {
-    resize(&game_state->game_objects);
-
-    GameObject* game_object = &(game_state->game_objects.objects[game_state->game_objects.count]); 
-    game_object->type = PROJECTILE;
-
-    game_object->position = vec2(x, y);
-    game_object->sub_type = type;
-    game_object->is_active = 1;
-
-    game_state->game_objects.objects[game_state->game_objects.count++] = *game_object;
+void drawChunkTiles(GameMap* map, int cx, int cy, Vector2 offset) {
+    for (int y = cy * CHUNK_SIZE; y < (cy + 1) * CHUNK_SIZE && y < map->height; y++){
+        for (int x = cx * CHUNK_SIZE; x < (cx + 1) * CHUNK_SIZE && x < map->width; x++){
+            Vector2 iso_coords = Vector2Subtract(toIso(vec2(x, y), true), offset);
+            drawSprite(&atlas, groundSprite(map, x, y), iso_coords, WHITE);
+        }
+    }
 }
 
-int checkProjectileCollision(GameObject* projectile, GameState* game_state) {
-    Vector2 pp = projectile->position;
-
-    for (int i=0; i < game_state->game_objects.count; i++) {
-        GameObject obj = game_state->game_objects.objects[i];
-        if (obj.position.y != pp.y) { continue; }
-
-        if (obj.type == ENEMY) {
-            Vector2 ep = obj.position;
-            bool collison_detected = (ep.x + 1) > pp.x;
-            if (collison_detected) {
-                return i;
-            }
+// the cached texture of the chunk, drawn again into the least recently used one if it is
+// not cached or the terrain changed. NULL when every texture is in use this frame
+GroundChunk* groundChunkLayer(GameMap* map, int chunk) {
+    int cx = chunk % map->chunks_x;
+    int cy = chunk / map->chunks_x;
+    GroundChunk* layer = NULL;
+    for (int i = 0; i < GROUND_CHUNK_CACHE; i++) {
+        GroundChunk* cached = &ground_chunks[i];
+        if (cached->layer.id != 0 && cached->chunk == chunk) {
+            layer = cached;
+            break;
+        }
+        if (cached->last_used != frame_count && (layer == NULL || cached->last_used < layer->last_used)) {
+            layer = cached;
         }
     }
+    if (layer == NULL) return NULL;
 
-    return -1;
+    layer->last_used = frame_count;
+    if (layer->layer.id != 0 && layer->chunk == chunk && layer->map_version == map->version) return layer;
+
+    if (layer->layer.id == 0) {
+        Vector2 size = groundChunkSize();
+        layer->layer = LoadRenderTexture(size.x, size.y);
+    }
+    layer->chunk = chunk;
+    layer->map_version = map->version;
+
+    // the layer is drawn relative to the grid, so only a terrain change needs a redraw, not a resize
+    BeginTextureMode(layer->layer);
+    ClearBackground(BLANK);
+    drawChunkTiles(map, cx, cy, groundChunkOrigin(cx, cy));
+    EndTextureMode();
+    return layer;
 }
 
-void grabUserInput(GameState* game_state) {
-    game_state->mouse_position = fromIso(GetMousePosition(), true);
+// the up to date texture of the chunk prepareGround() left in the cache, NULL if there is none
+GroundChunk* cachedGroundChunk(GameMap* map, int chunk) {
+    for (int i = 0; i < GROUND_CHUNK_CACHE; i++) {
+        GroundChunk* cached = &ground_chunks[i];
+        if (cached->layer.id != 0 && cached->chunk == chunk && cached->map_version == map->version) return cached;
+    }
+    return NULL;
+}
 
-    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-        int mpx = game_state->mouse_position.x;
-        int mpy = game_state->mouse_position.y;
-        if (mpx >= 0 && mpx < GRID_SIZE && mpy >= 0 && mpy < GRID_SIZE) {
-            if (mpx > 5 && mpx < GRID_SIZE - 2) {
-                addDefense(game_state->mouse_position, DEFENDER_TYPE_1, game_state);
-            }
+// the chunks in view, back to front one diagonal at a time. valid until the next scratchReset()
+int visibleGroundChunks(GameMap* map, VisibleCells* visible, int** chunks) {
+    int first_diagonal = (visible->min_sum - 2 * (CHUNK_SIZE - 1)) / CHUNK_SIZE;
+    int last_diagonal = visible->max_sum / CHUNK_SIZE;
+    if (first_diagonal < 0) first_diagonal = 0;
+    if (last_diagonal > map->chunks_x + map->chunks_y - 2) last_diagonal = map->chunks_x + map->chunks_y - 2;
+
+    *chunks = scratchAlloc(map->chunks_x * map->chunks_y * sizeof(int));
+    int count = 0;
+    for (int diagonal = first_diagonal; diagonal <= last_diagonal; diagonal++) {
+        for (int cy = visible->first_row / CHUNK_SIZE; cy <= visible->last_row / CHUNK_SIZE; cy++) {
+            int cx = diagonal - cy;
+            if (cx < 0 || cx >= map->chunks_x || !chunkVisible(visible, cx, cy)) { continue; }
+            (*chunks)[count++] = cy * map->chunks_x + cx;
         }
     }
+    return count;
 }
 
-void update(GameState* game_state) {
-    float delta_time = GetFrameTime();
-    // update enemy
-    int count = game_state -> game_objects.count;
-    int remove_count = 0;
-    for (int e = 0; e < count; e++){
-        enum GameObjectType object_type = game_state->game_objects.objects[e].type;
-
-        if (object_type == ENEMY) {
-            GameObject* enemy = &game_state->game_objects.objects[e];
-
-            if (enemy->game_object.enemy.life <= 0) {
-                enemy->is_active = 0;
-                remove_count++;
-                continue;
-            } 
-
-            int speed = 0;
-
-            if (enemy->sub_type == ENEMY_TYPE_1) {speed = 25;}
-            else if (enemy->sub_type == ENEMY_TYPE_2) {speed = 10;}
-
-            enemy->game_object.enemy.move_pct += speed * (delta_time / 1000);
-            enemy->game_object.enemy.move_pct = Clamp(enemy->game_object.enemy.move_pct, 0, 1);
-            // calculate the current iso position
-            enemy->game_object.enemy.current_iso_coord = Vector2Lerp(
-                enemy->game_object.enemy.start,
-                enemy->game_object.enemy.target,
-                enemy->game_object.enemy.move_pct
-            );
-            // this is necessary for depth sorting
-            enemy->position = fromIso(enemy->game_object.enemy.current_iso_coord, false);
-        } else if (object_type == DEFENSE) {
-            // TODO: projectile generation should be based on charging a certain bar which would be higher/lower depending on the effectiveness of the projectile
-            double last_attacked = (game_state->game_objects.objects[e].game_object.defense).last_attacked;
-            double time_passed = GetTime() - last_attacked;
-
-            if (time_passed < 4.0) { continue; }
-
-            Vector2 p = game_state->game_objects.objects[e].position;
-            addProjectile(p.x-1, p.y, PROJECTILE_TYPE_1, game_state);
-            game_state->game_objects.objects[e].game_object.defense.last_attacked = GetTime();
-        } else if (object_type == PROJECTILE) {
-            // TODO: projectiles will move with different speeds
-            game_state->game_objects.objects[e].position.x -= 2 * delta_time;
-
-            int collided_object_pos = checkProjectileCollision(&game_state->game_objects.objects[e], game_state);
-            
-            if (game_state->game_objects.objects[e].position.x < 0 || collided_object_pos != -1) {
-                game_state->game_objects.objects[e].is_active = 0;
-                remove_count++;
-
-                GameObject* enemy = &game_state->game_objects.objects[collided_object_pos];
-                enemy->game_object.enemy.life -= 40;
-            }
+// draws the textures of the chunks in view that are missing or out of date. EndTextureMode()
+// resets rlgl's transform, so this runs before BeginMode2D() and drawGround() only copies them
+void prepareGround(GameMap* map, VisibleCells* visible) {
+    int* chunks;
+    int count = visibleGroundChunks(map, visible, &chunks);
+    for (int i = 0; i < count; i++) {
+        groundChunkLayer(map, chunks[i]);
+    }
+}
 
+void drawGround(GameMap* map, VisibleCells* visible) {
+    int* chunks;
+    int count = visibleGroundChunks(map, visible, &chunks);
+    for (int i = 0; i < count; i++) {
+        int cx = chunks[i] % map->chunks_x;
+        int cy = chunks[i] / map->chunks_x;
+        GroundChunk* layer = cachedGroundChunk(map, chunks[i]);
+        if (layer == NULL) {
+            drawChunkTiles(map, cx, cy, vec2(0, 0));
+            continue;
         }
+        // render textures are stored upside down
+        Rectangle source = {0, 0, layer->layer.texture.width, -layer->layer.texture.height};
+        DrawTextureRec(layer->layer.texture, source, groundChunkOrigin(cx, cy), WHITE);
     }
-
-    qsort(game_state->game_objects.objects, game_state->game_objects.count, sizeof(GameObject), compareGameObjects);
-    game_state->game_objects.count -= remove_count;
 }
 
-void draw(GameState* game_state) {
-    // draw the grid
-    for (int y = 0; y < GRID_SIZE; y++){
-        for (int x = 0; x < GRID_SIZE; x++){
-            Vector2 grid_coords = vec2(x, y);
-            Vector2 iso_coords = toIso(grid_coords, true);
-            Vector2 mouse_coords = game_state->mouse_position;
-
-            Texture2D* ground_texture = &ground_grass_texture;
-
-            if (x >= GRID_SIZE - 2) {
-                ground_texture = &ground_pavement_texture;
-            } else if (x <= 5) {
-                ground_texture = &ground_sand_texture;
-            }
+// alpha is how far the display is between the last two simulation states.
+// inside BeginMode2D(), after prepareGround() with the same visible cells
+void draw(GameState* game_state, VisibleCells visible, float alpha) {
+    GameMap* map = &game_state->map;
 
-            if ((int) mouse_coords.y == y) {
-                if ((int) mouse_coords.x == x && (x > 5 && x < GRID_SIZE - 2)) {
-                    DrawTextureV(mouseover_texture, iso_coords, WHITE);
-                } else {
-                    DrawTextureV(*ground_texture, iso_coords, WHITE);
-                }
-                DrawTextureV(white_full_overlay_texture, iso_coords, WHITE);
+    // draw the grid
+    profileBegin(PROFILE_DRAW_GROUND);
+    drawGround(map, &visible);
+
+    // highlight the hovered row on top of the cached ground, then redraw every row in front of it.
+    // a redrawn row covers the top of the rows behind it too, so stopping early leaves seams
+    int mouse_x = (int) game_state->mouse_position.x;
+    int mouse_y = (int) game_state->mouse_position.y;
+    int first_x, last_x;
+    if (visibleRowSpan(&visible, mouse_y, &first_x, &last_x)) {
+        for (int x = first_x; x <= last_x; x++){
+            Vector2 iso_coords = toIso(vec2(x, mouse_y), true);
+            if (mouse_x == x && canPlaceDefense(map, x, mouse_y)) {
+                drawSprite(&atlas, SPRITE_MOUSEOVER, iso_coords, WHITE);
             } else {
-                DrawTextureV(*ground_texture, iso_coords, WHITE);
+                drawSprite(&atlas, groundSprite(map, x, mouse_y), iso_coords, WHITE);
             }
+            drawSprite(&atlas, SPRITE_FULL_OVERLAY, iso_coords, WHITE);
+        }
 
+        for (int y = mouse_y + 1; y <= visible.last_row; y++){
+            if (!visibleRowSpan(&visible, y, &first_x, &last_x)) { continue; }
+            for (int x = first_x; x <= last_x; x++){
+                drawSprite(&atlas, groundSprite(map, x, y), toIso(vec2(x, y), true), WHITE);
+            }
         }
     }
 
-    // draw the chars and objects
-    for (int e = 0; e < game_state->game_objects.count; e++) {
-        GameObject object = game_state->game_objects.objects[e];
-        Texture2D texture = GAME_OBJECT_TEXTURES[object.sub_type];
+    profileEnd(PROFILE_DRAW_GROUND);
 
-        if (object.type == DEFENSE) {
-            Vector2 iso_coords = toIso(object.position, true);
+    // draw the chars and objects
+    GameObjects* objects = &game_state->game_objects;
+    profileBegin(PROFILE_DRAW_SORT);
+    updateDrawOrder(&draw_order, game_state, &visible);
+    profileEnd(PROFILE_DRAW_SORT);
+
+    profileBegin(PROFILE_DRAW_OBJECTS);
+    for (int i = 0; i < draw_order.count; i++) {
+        DrawItem item = draw_order.items[i];
+
+        if (item.type == DEFENSE) {
+            enum SpriteId sprite = GAME_OBJECT_SPRITES[objects->defenses.sub_type[item.index]];
+            Vector2 iso_coords = toIso(objects->defenses.position[item.index], true);
             iso_coords.y -= TILE_HEIGHT;
-            DrawTextureV(texture, iso_coords, WHITE);
-
-            // draw charging animation
-            float diff = GetTime() - object.game_object.defense.last_attacked;
-            float pct = diff / 4.0;
-            BeginScissorMode((int) iso_coords.x, (int) ceil(iso_coords.y + 2 * TILE_HEIGHT * (1 - pct)), TILE_WIDTH, 2 * TILE_HEIGHT * pct);
-                DrawTextureV(white_half_overlay_texture, iso_coords, WHITE);
-            EndScissorMode();
-        } else if (object.type == ENEMY) {
-            Vector2 iso_coords = object.game_object.enemy.current_iso_coord;
-            iso_coords.x -= TILE_WIDTH / 2;
+            batchSprite(&sprite_batch, &atlas, sprite, iso_coords, WHITE);
+
+            // draw charging animation, the bottom of the overlay fills up
+            double render_time = game_state->time - (1 - alpha) * SIM_DT;
+            float diff = render_time - objects->defenses.last_attacked[item.index];
+            float pct = Clamp(diff / 4.0, 0, 1);
+            Rectangle bar = spriteBottom(&atlas, SPRITE_HALF_OVERLAY, pct);
+            batchSpriteRegion(&sprite_batch, &atlas, SPRITE_HALF_OVERLAY, bar, vec2(iso_coords.x, iso_coords.y + bar.y), WHITE);
+        } else if (item.type == ENEMY) {
+            enum SpriteId sprite = GAME_OBJECT_SPRITES[objects->enemies.sub_type[item.index]];
+            Vector2 position = Vector2Lerp(objects->enemies.prev_position[item.index], objects->enemies.position[item.index], alpha);
+            Vector2 iso_coords = toIso(position, true);
             iso_coords.y -= TILE_HEIGHT;
-            DrawTextureV(texture, iso_coords, WHITE);
-        } else if (object.type == PROJECTILE) {
-            Vector2 iso_coords = toIso(object.position, true);
+            batchSprite(&sprite_batch, &atlas, sprite, iso_coords, WHITE);
+        } else if (item.type == PROJECTILE) {
+            enum SpriteId sprite = GAME_OBJECT_SPRITES[objects->projectiles.sub_type[item.index]];
+            Vector2 position = Vector2Lerp(objects->projectiles.prev_position[item.index], objects->projectiles.position[item.index], alpha);
+            Vector2 iso_coords = toIso(position, true);
             iso_coords.y -= TILE_HEIGHT;
-            DrawTextureV(texture, vec2(iso_coords.x + TILE_WIDTH/4, iso_coords.y + TILE_WIDTH/4), WHITE);
+            batchSprite(&sprite_batch, &atlas, sprite, vec2(iso_coords.x + TILE_WIDTH/4, iso_coords.y + TILE_WIDTH/4), WHITE);
         }
     }
+    flushSpriteBatch(&sprite_batch);
+    profileEnd(PROFILE_DRAW_OBJECTS);
 }
 
-Texture2D loadTextureFromImage(char* filename) {
-    char path[256];
-    sprintf(path, "./assets/Isometric_Tiles_Pixel_Art/%s", filename);
-    Image image = LoadImage(path);
-    Texture2D texture = LoadTextureFromImage(image);
-    UnloadImage(image);
-    return texture;
+#define TRACE_FILE "blockwave_trace.json"
+
+void writeTrace(void) {
+    traceStop();
+    if (traceWrite(TRACE_FILE)) {
+        TraceLog(LOG_INFO, "TRACE: written to %s", TRACE_FILE);
+    } else {
+        TraceLog(LOG_WARNING, "TRACE: could not write %s", TRACE_FILE);
+    }
 }
 
-int main(void){
+// rolling per phase timings of the last PROFILE_HISTORY frames, toggled with F3
+void drawProfilerOverlay(void) {
+    int font_size = 20;
+    int line = font_size + 4;
+    int lines = 1 + PROFILE_ZONE_COUNT + 1 + COUNTER_COUNT;
+#ifdef DEBUG
+    lines++;
+#endif
+    DrawRectangle(5, 5, 440, lines * line + 10, Fade(BLACK, 0.7f));
+
+    char text[128];
+    int y = 10;
+    sprintf(text, "fps %d          min     avg     p99 ms", GetFPS());
+    DrawText(text, 10, y, font_size, WHITE);
+    y += line;
+
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        ProfileStats stats = profileZoneStats(z);
+        DrawText(PROFILE_ZONE_NAMES[z], 10 + PROFILE_ZONE_DEPTH[z] * font_size, y, font_size, WHITE);
+        sprintf(text, "%7.3f %7.3f %7.3f", stats.min, stats.avg, stats.p99);
+        DrawText(text, 200, y, font_size, WHITE);
+        y += line;
+    }
+
+    y += line;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        sprintf(text, "%s: %ld", PROFILE_COUNTER_NAMES[c], profileCounterValue(c));
+        DrawText(text, 10, y, font_size, WHITE);
+        y += line;
+    }
+#ifdef DEBUG
+    sprintf(text, "scratch high water: %zu KiB", scratchHighWater() / 1024);
+    DrawText(text, 10, y, font_size, WHITE);
+#endif
+}
+
+// shown until every sprite is in the atlas
+void drawLoadingScreen(float progress) {
+    int width = screen_width / 3;
+    int x = (screen_width - width) / 2;
+    int y = screen_height / 2;
+    DrawText("loading sprites", x, y - 40, 20, DARKGRAY);
+    DrawRectangleLines(x, y, width, 20, DARKGRAY);
+    DrawRectangle(x + 2, y + 2, (width - 4) * progress, 16, DARKBLUE);
+}
+
+void endFrame(void) {
+    EndDrawing();
+    if (launched > 0) {
+        TraceLog(LOG_INFO, "STARTUP: first frame after %.1f ms", (profilerNow() - launched) * 1000);
+        launched = 0;
+    }
+}
+
+// usage: game [--wave FILE] [--grid WxH] [--record FILE] [--replay FILE] [--speed N] [--load-threads N]
+// --speed runs a replay N times faster than real time, the game goes back to normal speed once it ends
+int main(int argc, char** argv){
+    launched = profilerNow();
     GameState game_state = {};
     GameObjects objs = {0};
     game_state.game_objects = objs;
 
+    char* wave_path = WAVE_DEFAULT;
+    int grid_width = GRID_DEFAULT_SIZE;
+    int grid_height = GRID_DEFAULT_SIZE;
+    int load_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char* replay_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--wave") == 0 && i + 1 < argc) {
+            wave_path = argv[++i];
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &grid_width, &grid_height) != 2) {
+                fprintf(stderr, "invalid grid size: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            replay_speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--load-threads") == 0 && i + 1 < argc) {
+            load_threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--wave FILE] [--grid WxH] [--record FILE] [--replay FILE] [--speed N] [--load-threads N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!setupMap(&game_state, grid_width, grid_height) || !setupLevel(&game_state, wave_path)) {
+        freeGameState(&game_state);
+        return 1;
+    }
+    // after the setup, the log is checked against the grid and wave of this run
+    if (replay_path != NULL) {
+        replay_end = loadInputLog(&game_state, replay_path);
+        if (replay_end == -1) {
+            fprintf(stderr, "could not replay input log %s\n", replay_path);
+            freeGameState(&game_state);
+            return 1;
+        }
+    }
+
     SetConfigFlags(FLAG_VSYNC_HINT);
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     
@@ -362,66 +403,106 @@ int main(void){
     screen_height = GetMonitorHeight(monitor);
     SetWindowSize(screen_width, GetMonitorHeight(monitor));
 
-    ground_grass_texture = loadTextureFromImage("Blocks/blocks_1.png");
-    ground_pavement_texture = loadTextureFromImage("Blocks/blocks_56.png");
-    ground_sand_texture = loadTextureFromImage("Blocks/blocks_32.png");
-    mouseover_texture = loadTextureFromImage("Blocks/blocks_99.png");
-    white_full_overlay_texture = loadTextureFromImage("Blocks/overlay.png");
-    white_half_overlay_texture = loadTextureFromImage("Blocks/half_overlay.png");
-
-    Texture2D enemy_type_1_texture = loadTextureFromImage("Blocks/blocks_30.png");
-    Texture2D enemy_type_2_texture = loadTextureFromImage("Blocks/blocks_31.png");
-    Texture2D defender_type_1_texture = loadTextureFromImage("Blocks/blocks_24.png");
-    Texture2D defender_type_2_texture = loadTextureFromImage("Blocks/blocks_58.png");
-
-    // load the long way, because it needs preprocessing.
-    Image block_12 = LoadImage("./assets/Isometric_Tiles_Pixel_Art/Blocks/blocks_12.png");
-    ImageResize(&block_12, TILE_WIDTH / 2, TILE_WIDTH / 2);
-    Texture2D projectile_1_texture = LoadTextureFromImage(block_12);
-    UnloadImage(block_12);
-
-    GAME_OBJECT_TEXTURES[ENEMY_TYPE_1] = enemy_type_1_texture;
-    GAME_OBJECT_TEXTURES[ENEMY_TYPE_2] = enemy_type_2_texture;
-    GAME_OBJECT_TEXTURES[DEFENDER_TYPE_1] = defender_type_1_texture;
-    GAME_OBJECT_TEXTURES[DEFENDER_TYPE_2] = defender_type_2_texture;
-    GAME_OBJECT_TEXTURES[PROJECTILE_TYPE_1] = projectile_1_texture;
-
-    addEnemy(vec2(0, 9), ENEMY_TYPE_1, &game_state);
-    addEnemy(vec2(0, 13), ENEMY_TYPE_2, &game_state);
-    addEnemy(vec2(0, 18), ENEMY_TYPE_2, &game_state);
+    // frames are drawn while the sprites decode, the game starts once they are all uploaded
+    AssetLoader loader;
+    startAssetLoader(&loader, &atlas, load_threads);
+    sprite_batch = loadSpriteBatch();
+    while (!updateAssetLoader(&loader) && !WindowShouldClose()) {
+        BeginDrawing();
+        ClearBackground(RAYWHITE);
+        drawLoadingScreen(assetLoaderProgress(&loader));
+        endFrame();
+    }
+    stopAssetLoader(&loader);
+
+    float accumulator = 0;
+    profilerEnable(true);
 
     while (!WindowShouldClose())
     {
+        // everything allocated from the scratch last frame is dropped here
+        scratchReset();
+        frame_count++;
+        profileBegin(PROFILE_FRAME);
+
+        profileBegin(PROFILE_INPUT);
         grabUserInput(&game_state);
-        update(&game_state);
+        if (IsKeyPressed(KEY_F3)) {
+            show_profiler = !show_profiler;
+        }
+        // F4 starts recording a trace, the next F4 writes it out
+        if (IsKeyPressed(KEY_F4)) {
+            if (traceRecording()) {
+                writeTrace();
+            } else {
+                traceStart();
+            }
+        }
+        profileEnd(PROFILE_INPUT);
+
+        // a long stall (window drag, breakpoint) would otherwise be caught up in one burst
+        bool replaying = game_state.tick < replay_end;
+        float speed = replaying ? replay_speed : 1;
+        accumulator += fminf(GetFrameTime(), 0.25f) * speed;
+        while (accumulator >= SIM_DT) {
+            update(&game_state, SIM_DT);
+            accumulator -= SIM_DT;
+
+            // the rest of a fast frame is not run at replay speed
+            if (replaying && game_state.tick == replay_end) {
+                accumulator = fmodf(accumulator, SIM_DT);
+                replaying = false;
+            }
+        }
 
         BeginDrawing();
         ClearBackground(RAYWHITE);
 
-        draw(&game_state);
+        profileBegin(PROFILE_DRAW);
+        VisibleCells visible = visibleCells(viewportArea(camera), &game_state.map);
+        prepareGround(&game_state.map, &visible);
+        BeginMode2D(camera);
+        draw(&game_state, visible, accumulator / SIM_DT);
+        EndMode2D();
+        profileEnd(PROFILE_DRAW);
 
-        // char text[255];
-        // sprintf(text, "fps: %d\ncount: %d\ncap: %d\n", GetFPS(), game_state.game_objects.count, game_state.game_objects.capacity);
+        if (show_profiler) {
+            drawProfilerOverlay();
+        }
+        if (traceRecording()) {
+            DrawText("recording trace (F4 to save)", 10, screen_height - 40, 20, RED);
+        }
+        if (game_state.tick < replay_end) {
+            char text[64];
+            sprintf(text, "replay x%g: tick %ld of %ld", replay_speed, game_state.tick, replay_end);
+            DrawText(text, 10, screen_height - 70, 20, DARKBLUE);
+        }
 
-        // DrawText(text, 10, 0, 60, BLACK);
+        endFrame();
 
-        EndDrawing();
+        profileEnd(PROFILE_FRAME);
+        profileFrameEnd();
     }
 
     {
         // free
-        free(game_state.game_objects.objects);
-
-        UnloadTexture(ground_grass_texture);
-        UnloadTexture(mouseover_texture);
-        UnloadTexture(white_full_overlay_texture);
-        UnloadTexture(white_half_overlay_texture);
-        
-        UnloadTexture(enemy_type_1_texture);
-        UnloadTexture(enemy_type_2_texture);
-        UnloadTexture(defender_type_1_texture);
-        UnloadTexture(defender_type_2_texture);
-        UnloadTexture(projectile_1_texture);
+        if (traceRecording()) {
+            writeTrace();
+        }
+        freeTrace();
+        if (record_path != NULL && !saveInputLog(&game_state, record_path)) {
+            TraceLog(LOG_WARNING, "REPLAY: could not write input log %s", record_path);
+        }
+        freeGameState(&game_state);
+        freeScratch();
+        for (int i = 0; i < GROUND_CHUNK_CACHE; i++) {
+            if (ground_chunks[i].layer.id != 0) {
+                UnloadRenderTexture(ground_chunks[i].layer);
+            }
+        }
+
+        unloadSpriteBatch(&sprite_batch);
+        unloadAtlas(&atlas);
     }
 
 
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include "atlas.h"
+#include "profiler.h"
+
+// decodes, resizes and packs the sprites once, so the game maps the result at startup instead of decoding pngs.
+// usage: game-pack [OUTPUT_BUNDLE]
+
+int main(int argc, char** argv) {
+    char* output_path = argc > 1 ? argv[1] : ATLAS_BUNDLE;
+    SetTraceLogLevel(LOG_WARNING);
+
+    double started = profilerNow();
+    Rectangle sprites[SPRITE_COUNT];
+    Image atlas_image = buildAtlasImage(sprites);
+    double decoded = profilerNow() - started;
+
+    if (!saveAtlasBundle(atlas_image, sprites, output_path)) {
+        fprintf(stderr, "could not write %s\n", output_path);
+        UnloadImage(atlas_image);
+        return 1;
+    }
+
+    printf("sprites: %d\n", SPRITE_COUNT);
+    printf("atlas: %dx%d\n", atlas_image.width, atlas_image.height);
+    printf("decode time: %.2fms\n", decoded * 1000);
+    printf("bundle: %s\n", output_path);
+    UnloadImage(atlas_image);
+    return 0;
+}
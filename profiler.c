@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profiler.h"
+#include "trace.h"
+
+const char* PROFILE_ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+    [PROFILE_FRAME] = "frame",
+    [PROFILE_INPUT] = "input",
+    [PROFILE_UPDATE] = "update",
+    [PROFILE_UPDATE_FLOW_FIELD] = "flow field",
+    [PROFILE_UPDATE_ENEMIES] = "enemies",
+    [PROFILE_UPDATE_DEFENSES] = "defenses",
+    [PROFILE_UPDATE_PROJECTILES] = "projectiles",
+    [PROFILE_DRAW] = "draw",
+    [PROFILE_DRAW_GROUND] = "ground",
+    [PROFILE_DRAW_SORT] = "sort",
+    [PROFILE_DRAW_OBJECTS] = "objects",
+};
+
+const int PROFILE_ZONE_DEPTH[PROFILE_ZONE_COUNT] = {
+    [PROFILE_UPDATE_FLOW_FIELD] = 1,
+    [PROFILE_UPDATE_ENEMIES] = 1,
+    [PROFILE_UPDATE_DEFENSES] = 1,
+    [PROFILE_UPDATE_PROJECTILES] = 1,
+    [PROFILE_DRAW_GROUND] = 1,
+    [PROFILE_DRAW_SORT] = 1,
+    [PROFILE_DRAW_OBJECTS] = 1,
+};
+
+const char* PROFILE_COUNTER_NAMES[COUNTER_COUNT] = {
+    [COUNTER_ENEMIES] = "enemies",
+    [COUNTER_DEFENSES] = "defenses",
+    [COUNTER_PROJECTILES] = "projectiles",
+    [COUNTER_SIM_TICKS] = "sim ticks",
+    [COUNTER_COMMITTED_KB] = "entity memory KiB",
+    [COUNTER_FLOW_FIX_CELLS] = "flow fix cells",
+    [COUNTER_FLOW_FIX_US] = "flow fix us",
+    [COUNTER_FLOW_FULL_REBUILDS] = "flow full rebuilds",
+    [COUNTER_SPRITE_DRAW_CALLS] = "sprite draw calls",
+};
+
+typedef struct Profiler {
+    bool enabled;
+    double started[PROFILE_ZONE_COUNT];
+    double current[PROFILE_ZONE_COUNT]; // seconds spent in the frame so far
+    double history[PROFILE_ZONE_COUNT][PROFILE_HISTORY];
+    long counters[COUNTER_COUNT];
+    long last_counters[COUNTER_COUNT];
+    int frames; // total, the history holds the last PROFILE_HISTORY of them
+} Profiler;
+
+static Profiler profiler;
+
+double profilerNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void profilerEnable(bool enabled) {
+    profiler.enabled = enabled;
+}
+
+bool profilerEnabled(void) {
+    return profiler.enabled;
+}
+
+void profileBegin(enum ProfileZone zone) {
+    if (!profiler.enabled && !traceRecording()) { return; }
+    profiler.started[zone] = profilerNow();
+}
+
+void profileEnd(enum ProfileZone zone) {
+    if (!profiler.enabled && !traceRecording()) { return; }
+
+    double now = profilerNow();
+    profiler.current[zone] += now - profiler.started[zone];
+    traceEvent(PROFILE_ZONE_NAMES[zone], profiler.started[zone], now);
+}
+
+void profileCounterSet(enum ProfileCounter counter, long value) {
+    if (!profiler.enabled) { return; }
+    profiler.counters[counter] = value;
+}
+
+void profileCounterAdd(enum ProfileCounter counter, long value) {
+    if (!profiler.enabled) { return; }
+    profiler.counters[counter] += value;
+}
+
+void profileFrameEnd(void) {
+    if (!profiler.enabled) { return; }
+
+    int slot = profiler.frames % PROFILE_HISTORY;
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        profiler.history[z][slot] = profiler.current[z];
+        profiler.current[z] = 0;
+    }
+
+    memcpy(profiler.last_counters, profiler.counters, sizeof(profiler.counters));
+    // counters that are added to start again every frame, the rest are set anyway
+    profiler.counters[COUNTER_SIM_TICKS] = 0;
+    profiler.counters[COUNTER_SPRITE_DRAW_CALLS] = 0;
+    profiler.frames++;
+}
+
+int compareDoubles(const void* a, const void* b) {
+    double d1 = *(const double*) a;
+    double d2 = *(const double*) b;
+    return (d1 > d2) - (d1 < d2);
+}
+
+ProfileStats profileZoneStats(enum ProfileZone zone) {
+    ProfileStats stats = {0};
+    int count = profiler.frames < PROFILE_HISTORY ? profiler.frames : PROFILE_HISTORY;
+    if (count == 0) { return stats; }
+
+    double sorted[PROFILE_HISTORY];
+    memcpy(sorted, profiler.history[zone], count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compareDoubles);
+
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        total += sorted[i];
+    }
+
+    stats.min = sorted[0] * 1000;
+    stats.avg = total / count * 1000;
+    stats.p99 = sorted[(count * 99) / 100] * 1000;
+    return stats;
+}
+
+long profileCounterValue(enum ProfileCounter counter) {
+    return profiler.last_counters[counter];
+}
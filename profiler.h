@@ -0,0 +1,67 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+// number of frames the min/avg/p99 are taken over
+#define PROFILE_HISTORY 240
+
+enum ProfileZone {
+    PROFILE_FRAME,
+    PROFILE_INPUT,
+    PROFILE_UPDATE,
+    PROFILE_UPDATE_FLOW_FIELD,
+    PROFILE_UPDATE_ENEMIES,
+    PROFILE_UPDATE_DEFENSES,
+    PROFILE_UPDATE_PROJECTILES,
+    PROFILE_DRAW,
+    PROFILE_DRAW_GROUND,
+    PROFILE_DRAW_SORT,
+    PROFILE_DRAW_OBJECTS,
+    PROFILE_ZONE_COUNT,
+};
+
+enum ProfileCounter {
+    COUNTER_ENEMIES,
+    COUNTER_DEFENSES,
+    COUNTER_PROJECTILES,
+    COUNTER_SIM_TICKS, // updates run in the frame
+    COUNTER_COMMITTED_KB, // entity memory
+    COUNTER_FLOW_FIX_CELLS, // cells the last flow field repair solved again
+    COUNTER_FLOW_FIX_US, // time it took
+    COUNTER_FLOW_FULL_REBUILDS,
+    COUNTER_SPRITE_DRAW_CALLS, // instanced draw calls in the frame
+    COUNTER_COUNT,
+};
+
+typedef struct ProfileStats {
+    double min; // milliseconds
+    double avg;
+    double p99;
+} ProfileStats;
+
+extern const char* PROFILE_ZONE_NAMES[PROFILE_ZONE_COUNT];
+extern const int PROFILE_ZONE_DEPTH[PROFILE_ZONE_COUNT]; // nesting, for indenting reports
+extern const char* PROFILE_COUNTER_NAMES[COUNTER_COUNT];
+
+// monotonic wall clock in seconds, works without a window
+double profilerNow(void);
+
+// everything below is a no-op until the profiler is enabled, zones are also
+// passed on to the trace recorder while it records
+void profilerEnable(bool enabled);
+bool profilerEnabled(void);
+
+// a zone may be entered several times per frame (e.g. one update per sim tick), the times add up
+void profileBegin(enum ProfileZone zone);
+void profileEnd(enum ProfileZone zone);
+void profileCounterSet(enum ProfileCounter counter, long value);
+void profileCounterAdd(enum ProfileCounter counter, long value);
+// closes the frame and pushes its zone times into the history
+void profileFrameEnd(void);
+
+ProfileStats profileZoneStats(enum ProfileZone zone);
+// value of the counter in the last finished frame
+long profileCounterValue(enum ProfileCounter counter);
+
+#endif
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "raylib.h"
+#include "game.h"
+#include "atlas.h"
+#include "draw_order.h"
+#include "viewport.h"
+#include "sprite_batch.h"
+#include "rlgl_subset.h"
+#include "profiler.h"
+#include "scratch.h"
+#include "lcg.h"
+
+// draws moving enemies and projectiles and charging defenses into an offscreen target without a window, once through
+// the sprite batch and once a quad at a time through raylib. without a gpu mesa's llvmpipe runs it,
+// which is far slower than any gpu but shows what each renderer costs.
+// usage: game-render-bench [OUTPUT_CSV]
+
+#define RENDER_BENCH_WIDTH 1920
+#define RENDER_BENCH_HEIGHT 1080
+// at zoom 0.5 the whole map fits the frame, so every object is drawn
+#define RENDER_BENCH_GRID 64
+#define RENDER_BENCH_FRAMES 20
+#define RENDER_BENCH_WARMUP 3
+
+const int RENDER_ENTITY_COUNTS[] = {1000, 10000, 50000, 100000};
+#define RENDER_ENTITY_COUNT_STEPS (sizeof(RENDER_ENTITY_COUNTS) / sizeof(RENDER_ENTITY_COUNTS[0]))
+
+// raylib's gl loader calls every gl function through one of these pointers. the bench swaps
+// the draw calls for ones that count them first, so both renderers are counted the same way
+extern void (*glad_glDrawArrays)(unsigned int mode, int first, int count);
+extern void (*glad_glDrawElements)(unsigned int mode, int count, unsigned int type, const void* indices);
+extern void (*glad_glDrawArraysInstanced)(unsigned int mode, int first, int count, int instances);
+extern void (*glad_glDrawElementsInstanced)(unsigned int mode, int count, unsigned int type, const void* indices, int instances);
+
+/* global variables start */
+EGLDisplay egl_display = EGL_NO_DISPLAY;
+EGLContext egl_context = EGL_NO_CONTEXT;
+void (*glFinishProc)(void);
+Atlas atlas;
+SpriteBatch sprite_batch;
+long gl_draw_calls;
+void (*drawArrays)(unsigned int mode, int first, int count);
+void (*drawElements)(unsigned int mode, int count, unsigned int type, const void* indices);
+void (*drawArraysInstanced)(unsigned int mode, int first, int count, int instances);
+void (*drawElementsInstanced)(unsigned int mode, int count, unsigned int type, const void* indices, int instances);
+/* global variables end */
+
+void countDrawArrays(unsigned int mode, int first, int count) {
+    gl_draw_calls++;
+    drawArrays(mode, first, count);
+}
+
+void countDrawElements(unsigned int mode, int count, unsigned int type, const void* indices) {
+    gl_draw_calls++;
+    drawElements(mode, count, type, indices);
+}
+
+void countDrawArraysInstanced(unsigned int mode, int first, int count, int instances) {
+    gl_draw_calls++;
+    drawArraysInstanced(mode, first, count, instances);
+}
+
+void countDrawElementsInstanced(unsigned int mode, int count, unsigned int type, const void* indices, int instances) {
+    gl_draw_calls++;
+    drawElementsInstanced(mode, count, type, indices, instances);
+}
+
+void countGlDrawCalls(void) {
+    drawArrays = glad_glDrawArrays;
+    drawElements = glad_glDrawElements;
+    drawArraysInstanced = glad_glDrawArraysInstanced;
+    drawElementsInstanced = glad_glDrawElementsInstanced;
+    glad_glDrawArrays = countDrawArrays;
+    glad_glDrawElements = countDrawElements;
+    glad_glDrawArraysInstanced = countDrawArraysInstanced;
+    glad_glDrawElementsInstanced = countDrawElementsInstanced;
+}
+
+// a gl 3.3 context with no window and no surface, rlgl draws into render textures only
+bool initHeadlessGl(void) {
+    egl_display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, NULL, NULL)) return false;
+    if (!eglBindAPI(EGL_OPENGL_API)) return false;
+
+    EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    egl_context = eglCreateContext(egl_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+    if (egl_context == EGL_NO_CONTEXT) return false;
+    if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) return false;
+
+    rlLoadExtensions(eglGetProcAddress);
+    countGlDrawCalls();
+    rlglInit(RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT);
+    glFinishProc = (void (*)(void)) eglGetProcAddress("glFinish");
+    return true;
+}
+
+void closeHeadlessGl(void) {
+    rlglClose();
+    eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(egl_display, egl_context);
+    eglTerminate(egl_display);
+}
+
+unsigned int render_seed;
+
+// half enemies, an eighth defenses and the rest projectiles. enemies walk the even rows and the
+// rest is on the odd ones, so nothing collides or blocks a path. enemies that leak and
+// projectiles that leave the grid are replaced
+void topUp(GameState* game_state, int entities) {
+    GameObjects* objects = &game_state->game_objects;
+    while (objects->enemies.count < entities / 2) {
+        int e = objects->enemies.count;
+        addEnemy(vec2(lcgInt(&render_seed, RENDER_BENCH_GRID - 1), 2 * lcgInt(&render_seed, RENDER_BENCH_GRID / 2)), e % 2 ? ENEMY_TYPE_2 : ENEMY_TYPE_1, game_state);
+    }
+    while (objects->defenses.count < entities / 8) {
+        addDefense(vec2(lcgInt(&render_seed, RENDER_BENCH_GRID - 1), 2 * lcgInt(&render_seed, RENDER_BENCH_GRID / 2) + 1), DEFENDER_TYPE_1, game_state);
+    }
+    while (objects->projectiles.count < entities - entities / 2 - entities / 8) {
+        addProjectile(lcgInt(&render_seed, RENDER_BENCH_GRID), 2 * lcgInt(&render_seed, RENDER_BENCH_GRID / 2) + 1, PROJECTILE_TYPE_1, game_state);
+    }
+}
+
+void drawObject(GameState* game_state, DrawItem item, bool batched) {
+    GameObjects* objects = &game_state->game_objects;
+    Vector2 position;
+    enum SpriteId sprite;
+    if (item.type == DEFENSE) {
+        position = objects->defenses.position[item.index];
+        sprite = GAME_OBJECT_SPRITES[objects->defenses.sub_type[item.index]];
+    } else if (item.type == ENEMY) {
+        position = objects->enemies.position[item.index];
+        sprite = GAME_OBJECT_SPRITES[objects->enemies.sub_type[item.index]];
+    } else {
+        position = objects->projectiles.position[item.index];
+        sprite = GAME_OBJECT_SPRITES[objects->projectiles.sub_type[item.index]];
+    }
+
+    Vector2 iso_coords = toIso(position, true);
+    iso_coords.y -= TILE_HEIGHT;
+    if (item.type == PROJECTILE) {
+        iso_coords = vec2(iso_coords.x + TILE_WIDTH/4, iso_coords.y + TILE_WIDTH/4);
+    }
+
+    if (batched) {
+        batchSprite(&sprite_batch, &atlas, sprite, iso_coords, WHITE);
+    } else {
+        drawSprite(&atlas, sprite, iso_coords, WHITE);
+    }
+
+    // the charge bar as draw() does it
+    if (item.type == DEFENSE) {
+        float pct = fminf((game_state->time - objects->defenses.last_attacked[item.index]) / 4.0, 1);
+        Rectangle bar = spriteBottom(&atlas, SPRITE_HALF_OVERLAY, pct);
+        Vector2 bar_position = vec2(iso_coords.x, iso_coords.y + bar.y);
+        if (batched) {
+            batchSpriteRegion(&sprite_batch, &atlas, SPRITE_HALF_OVERLAY, bar, bar_position, WHITE);
+        } else {
+            drawSpriteRegion(&atlas, SPRITE_HALF_OVERLAY, bar, bar_position, WHITE);
+        }
+    }
+}
+
+typedef struct RenderResult {
+    double cpu_ms; // per frame, building the draw order and submitting it
+    double frame_ms; // until the gpu is done with the frame
+    long draw_calls; // gl draw calls of the last frame, raylib's own batch included
+    Image last_frame;
+} RenderResult;
+
+RenderResult benchFrames(int entities, bool batched, RenderTexture2D target) {
+    GameState game_state = {0};
+    render_seed = 42;
+    setupMap(&game_state, RENDER_BENCH_GRID, RENDER_BENCH_GRID);
+
+    Camera2D camera = {
+        .offset = {RENDER_BENCH_WIDTH / 2, RENDER_BENCH_HEIGHT / 2},
+        .target = toIso(vec2(RENDER_BENCH_GRID / 2, RENDER_BENCH_GRID / 2), true),
+        .zoom = 0.5f,
+    };
+    DrawOrder order = {0};
+
+    RenderResult result = {0};
+    for (int f = 0; f < RENDER_BENCH_WARMUP + RENDER_BENCH_FRAMES; f++) {
+        topUp(&game_state, entities);
+        update(&game_state, SIM_DT);
+        scratchReset();
+
+        double started = profilerNow();
+        gl_draw_calls = 0;
+        BeginTextureMode(target);
+        ClearBackground(BLANK);
+        BeginMode2D(camera);
+
+        VisibleCells visible = visibleCells(viewportArea(camera), &game_state.map);
+        updateDrawOrder(&order, &game_state, &visible);
+        for (int i = 0; i < order.count; i++) {
+            drawObject(&game_state, order.items[i], batched);
+        }
+        flushSpriteBatch(&sprite_batch);
+
+        EndMode2D();
+        EndTextureMode();
+        double submitted = profilerNow();
+        result.draw_calls = gl_draw_calls;
+        glFinishProc();
+
+        if (f >= RENDER_BENCH_WARMUP) {
+            result.cpu_ms += (submitted - started) * 1000 / RENDER_BENCH_FRAMES;
+            result.frame_ms += (profilerNow() - started) * 1000 / RENDER_BENCH_FRAMES;
+        }
+    }
+    result.last_frame = LoadImageFromTexture(target.texture);
+
+    freeGameState(&game_state);
+    return result;
+}
+
+// both renderers get the same objects, their frames should be the same
+int differentPixels(Image a, Image b) {
+    Color* pixels_a = a.data;
+    Color* pixels_b = b.data;
+    int different = 0;
+    for (int p = 0; p < a.width * a.height; p++) {
+        different += pixels_a[p].r != pixels_b[p].r || pixels_a[p].g != pixels_b[p].g || pixels_a[p].b != pixels_b[p].b || pixels_a[p].a != pixels_b[p].a;
+    }
+    return different;
+}
+
+int main(int argc, char** argv) {
+    char* output_path = argc > 1 ? argv[1] : "render_bench_results.csv";
+
+    SetTraceLogLevel(LOG_WARNING);
+    if (!initHeadlessGl()) {
+        fprintf(stderr, "could not create a headless gl 3.3 context (egl error 0x%x)\n", eglGetError());
+        return 1;
+    }
+    const unsigned char* (*glGetStringProc)(unsigned int) = (const unsigned char* (*)(unsigned int)) eglGetProcAddress("glGetString");
+    printf("renderer: %s\n", glGetStringProc(0x1F01));
+
+    FILE* output = fopen(output_path, "w");
+    if (output == NULL) {
+        fprintf(stderr, "could not open %s\n", output_path);
+        closeHeadlessGl();
+        return 1;
+    }
+    fprintf(output, "renderer,entities,frames,cpu_ms_per_frame,ms_per_frame,draw_calls,different_pixels\n");
+
+    // toIso() centers the grid on the screen
+    screen_width = RENDER_BENCH_WIDTH;
+    screen_height = RENDER_BENCH_HEIGHT;
+    atlas = loadAtlas();
+    sprite_batch = loadSpriteBatch();
+    RenderTexture2D target = LoadRenderTexture(RENDER_BENCH_WIDTH, RENDER_BENCH_HEIGHT);
+
+    for (size_t n = 0; n < RENDER_ENTITY_COUNT_STEPS; n++) {
+        int entities = RENDER_ENTITY_COUNTS[n];
+        RenderResult quads = benchFrames(entities, false, target);
+        RenderResult batched = benchFrames(entities, true, target);
+        int different = differentPixels(quads.last_frame, batched.last_frame);
+
+        printf("%7d entities   raylib quads %8.2f ms cpu %8.2f ms frame %5ld draw calls   sprite batch %8.2f ms cpu %8.2f ms frame %3ld draw calls   %d pixels differ\n",
+            entities, quads.cpu_ms, quads.frame_ms, quads.draw_calls, batched.cpu_ms, batched.frame_ms, batched.draw_calls, different);
+        fprintf(output, "raylib_quads,%d,%d,%.3f,%.3f,%ld,0\n", entities, RENDER_BENCH_FRAMES, quads.cpu_ms, quads.frame_ms, quads.draw_calls);
+        fprintf(output, "sprite_batch,%d,%d,%.3f,%.3f,%ld,%d\n", entities, RENDER_BENCH_FRAMES, batched.cpu_ms, batched.frame_ms, batched.draw_calls, different);
+
+        UnloadImage(quads.last_frame);
+        UnloadImage(batched.last_frame);
+    }
+
+    fclose(output);
+    UnloadRenderTexture(target);
+    unloadSpriteBatch(&sprite_batch);
+    unloadAtlas(&atlas);
+    freeScratch();
+    closeHeadlessGl();
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef RLGL_SUBSET_H
+#define RLGL_SUBSET_H
+
+#include <stdbool.h>
+#include "raylib.h"
+
+// the rlgl functions of lib/libraylib.a (raylib 5.5) the renderer uses directly.
+// include/ only ships raylib.h and raymath.h, the declarations match rlgl.h of that version
+
+#define RL_UNSIGNED_BYTE 0x1401
+#define RL_FLOAT 0x1406
+
+void rlglInit(int width, int height);
+void rlglClose(void);
+void rlLoadExtensions(void* loader);
+
+void rlDrawRenderBatchActive(void);
+Matrix rlGetMatrixModelview(void);
+Matrix rlGetMatrixProjection(void);
+
+void rlEnableShader(unsigned int id);
+void rlDisableShader(void);
+void rlActiveTextureSlot(int slot);
+void rlEnableTexture(unsigned int id);
+void rlDisableTexture(void);
+
+unsigned int rlLoadVertexArray(void);
+bool rlEnableVertexArray(unsigned int vao_id);
+void rlDisableVertexArray(void);
+void rlUnloadVertexArray(unsigned int vao_id);
+unsigned int rlLoadVertexBuffer(const void* buffer, int size, bool dynamic);
+void rlUpdateVertexBuffer(unsigned int buffer_id, const void* data, int data_size, int offset);
+void rlUnloadVertexBuffer(unsigned int vbo_id);
+void rlSetVertexAttribute(unsigned int index, int component_size, int type, bool normalized, int stride, int offset);
+void rlSetVertexAttributeDivisor(unsigned int index, int divisor);
+void rlEnableVertexAttribute(unsigned int index);
+void rlDrawVertexArrayInstanced(int offset, int count, int instances);
+
+#endif
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+#include "scratch.h"
+
+/* global variables start */
+Arena scratch_arena;
+size_t scratch_used;
+#ifdef DEBUG
+size_t scratch_high_water;
+#endif
+/* global variables end */
+
+void* scratchAlloc(size_t bytes) {
+    if (scratch_arena.base == NULL) {
+        arenaInit(&scratch_arena, SCRATCH_RESERVE);
+        arenaReserve(&scratch_arena, SCRATCH_RESERVE);
+    }
+
+    size_t from = (scratch_used + 15) & ~(size_t) 15;
+    size_t to = from + bytes;
+    if (to > scratch_arena.reserved) {
+        fprintf(stderr, "scratch: out of space (%zu of %zu bytes used)\n", from, scratch_arena.reserved);
+        exit(1);
+    }
+
+    // only the first frames that reach a new size commit memory
+    if (to > scratch_arena.committed) {
+        arenaCommit(&scratch_arena, scratch_arena.base, scratch_arena.committed, to);
+    }
+    scratch_used = to;
+#ifdef DEBUG
+    if (scratch_used > scratch_high_water) {
+        scratch_high_water = scratch_used;
+    }
+#endif
+    return scratch_arena.base + from;
+}
+
+void scratchReset(void) {
+    scratch_used = 0;
+}
+
+void freeScratch(void) {
+    arenaFree(&scratch_arena);
+    scratch_used = 0;
+}
+
+#ifdef DEBUG
+size_t scratchHighWater(void) {
+    return scratch_high_water;
+}
+#endif
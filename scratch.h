@@ -0,0 +1,24 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include <stddef.h>
+
+// per frame linear allocator for temporaries (sort keys, draw lists).
+// allocations are a pointer bump and are all dropped at once by scratchReset(),
+// the memory is committed once and reused, so a frame does no malloc/free at all
+
+// address space of the scratch buffer, running out of it is fatal
+#define SCRATCH_RESERVE ((size_t) 64 << 20)
+
+// 16 byte aligned, valid until the next scratchReset()
+void* scratchAlloc(size_t bytes);
+// called once at the top of every frame
+void scratchReset(void);
+void freeScratch(void);
+
+#ifdef DEBUG
+// most bytes in use at once since the start
+size_t scratchHighWater(void);
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include "sprite_batch.h"
+#include "raymath.h"
+#include "rlgl_subset.h"
+#include "profiler.h"
+
+const char* SPRITE_VERTEX_SHADER =
+    "#version 330\n"
+    "in vec2 vertexCorner;\n"
+    "in vec2 instancePosition;\n"
+    "in vec2 instanceSize;\n"
+    "in vec4 instanceSource;\n"
+    "in vec4 instanceTint;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 fragTexCoord;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    fragTexCoord = instanceSource.xy + vertexCorner * instanceSource.zw;\n"
+    "    fragColor = instanceTint;\n"
+    "    gl_Position = mvp * vec4(instancePosition + vertexCorner * instanceSize, 0.0, 1.0);\n"
+    "}\n";
+
+const char* SPRITE_FRAGMENT_SHADER =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "out vec4 finalColor;\n"
+    "void main() {\n"
+    "    finalColor = texture(texture0, fragTexCoord) * fragColor;\n"
+    "}\n";
+
+// two triangles, the order raylib's batch uses for its quads
+const float SPRITE_QUAD_CORNERS[] = {
+    0, 0,  0, 1,  1, 1,
+    0, 0,  1, 1,  1, 0,
+};
+
+typedef struct InstanceAttribute {
+    const char* name;
+    int components;
+    int type;
+    bool normalized;
+    int offset;
+} InstanceAttribute;
+
+const InstanceAttribute SPRITE_INSTANCE_ATTRIBUTES[] = {
+    {"instancePosition", 2, RL_FLOAT, false, offsetof(SpriteInstance, position)},
+    {"instanceSize", 2, RL_FLOAT, false, offsetof(SpriteInstance, size)},
+    {"instanceSource", 4, RL_FLOAT, false, offsetof(SpriteInstance, source)},
+    {"instanceTint", 4, RL_UNSIGNED_BYTE, true, offsetof(SpriteInstance, tint)},
+};
+#define SPRITE_INSTANCE_ATTRIBUTE_COUNT (sizeof(SPRITE_INSTANCE_ATTRIBUTES) / sizeof(SPRITE_INSTANCE_ATTRIBUTES[0]))
+
+SpriteBatch loadSpriteBatch(void) {
+    SpriteBatch batch = {0};
+    batch.shader = LoadShaderFromMemory(SPRITE_VERTEX_SHADER, SPRITE_FRAGMENT_SHADER);
+    int corner_location = GetShaderLocationAttrib(batch.shader, "vertexCorner");
+    if (!IsShaderReady(batch.shader) || corner_location == -1) {
+        // batchSprite() draws through raylib instead
+        TraceLog(LOG_WARNING, "SPRITES: could not load the sprite shader, drawing sprites one by one");
+        return batch;
+    }
+    batch.mvp_location = GetShaderLocation(batch.shader, "mvp");
+
+    batch.vao = rlLoadVertexArray();
+    rlEnableVertexArray(batch.vao);
+
+    batch.corner_buffer = rlLoadVertexBuffer(SPRITE_QUAD_CORNERS, sizeof(SPRITE_QUAD_CORNERS), false);
+    rlSetVertexAttribute(corner_location, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(corner_location);
+
+    // the attribute offsets are set by every flush
+    batch.instance_buffer = rlLoadVertexBuffer(NULL, SPRITE_BATCH_BUFFER_FLUSHES * SPRITE_BATCH_CAPACITY * sizeof(SpriteInstance), true);
+    for (size_t a = 0; a < SPRITE_INSTANCE_ATTRIBUTE_COUNT; a++) {
+        int location = GetShaderLocationAttrib(batch.shader, SPRITE_INSTANCE_ATTRIBUTES[a].name);
+        batch.instance_locations[a] = location;
+        rlSetVertexAttributeDivisor(location, 1);
+        rlEnableVertexAttribute(location);
+    }
+    rlDisableVertexArray();
+
+    batch.instances = malloc(SPRITE_BATCH_CAPACITY * sizeof(SpriteInstance));
+    return batch;
+}
+
+void unloadSpriteBatch(SpriteBatch* batch) {
+    if (batch->vao != 0) {
+        rlUnloadVertexArray(batch->vao);
+        rlUnloadVertexBuffer(batch->corner_buffer);
+        rlUnloadVertexBuffer(batch->instance_buffer);
+    }
+    UnloadShader(batch->shader);
+    free(batch->instances);
+    *batch = (SpriteBatch) {0};
+}
+
+void batchSprite(SpriteBatch* batch, Atlas* atlas, enum SpriteId sprite, Vector2 position, Color tint) {
+    Rectangle source = atlas->sprites[sprite];
+    batchSpriteRegion(batch, atlas, sprite, (Rectangle) {0, 0, source.width, source.height}, position, tint);
+}
+
+void batchSpriteRegion(SpriteBatch* batch, Atlas* atlas, enum SpriteId sprite, Rectangle region, Vector2 position, Color tint) {
+    if (batch->vao == 0) {
+        drawSpriteRegion(atlas, sprite, region, position, tint);
+        return;
+    }
+    if (batch->count == SPRITE_BATCH_CAPACITY) {
+        flushSpriteBatch(batch);
+    }
+
+    Rectangle source = atlas->sprites[sprite];
+    float width = atlas->texture.width;
+    float height = atlas->texture.height;
+    batch->texture = atlas->texture;
+    batch->instances[batch->count++] = (SpriteInstance) {
+        .position = position,
+        .size = {region.width, region.height},
+        .source = {(source.x + region.x) / width, (source.y + region.y) / height, region.width / width, region.height / height},
+        .tint = tint,
+    };
+}
+
+void flushSpriteBatch(SpriteBatch* batch) {
+    if (batch->count == 0) { return; }
+
+    // what raylib has queued goes first, so the sprites land on top of it
+    rlDrawRenderBatchActive();
+
+    // the same matrix raylib's own shader gets
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    SetShaderValueMatrix(batch->shader, batch->mvp_location, mvp);
+    rlEnableShader(batch->shader.id);
+    rlActiveTextureSlot(0);
+    rlEnableTexture(batch->texture.id);
+
+    if (batch->buffer_offset + batch->count > SPRITE_BATCH_BUFFER_FLUSHES * SPRITE_BATCH_CAPACITY) {
+        batch->buffer_offset = 0;
+    }
+    int base = batch->buffer_offset * sizeof(SpriteInstance);
+
+    rlEnableVertexArray(batch->vao);
+    rlUpdateVertexBuffer(batch->instance_buffer, batch->instances, batch->count * sizeof(SpriteInstance), base);
+    for (size_t a = 0; a < SPRITE_INSTANCE_ATTRIBUTE_COUNT; a++) {
+        InstanceAttribute attribute = SPRITE_INSTANCE_ATTRIBUTES[a];
+        rlSetVertexAttribute(batch->instance_locations[a], attribute.components, attribute.type, attribute.normalized, sizeof(SpriteInstance), base + attribute.offset);
+    }
+    rlDrawVertexArrayInstanced(0, 6, batch->count);
+    rlDisableVertexArray();
+    batch->buffer_offset += batch->count;
+
+    rlDisableTexture();
+    rlDisableShader();
+
+    profileCounterAdd(COUNTER_SPRITE_DRAW_CALLS, 1);
+    batch->count = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "raylib.h"
+#include "atlas.h"
+
+// most sprites one draw call takes, more are drawn in several
+#define SPRITE_BATCH_CAPACITY 65536
+// the gpu buffer holds this many flushes, each one is written behind the last so
+// it does not overwrite what the draw before it may still be reading
+#define SPRITE_BATCH_BUFFER_FLUSHES 2
+
+// one sprite as the shader reads it, per instance of a shared quad
+typedef struct SpriteInstance {
+    Vector2 position; // top left corner in the world
+    Vector2 size;
+    Rectangle source; // in the atlas texture, 0 to 1
+    Color tint;
+} SpriteInstance;
+
+// atlas sprites drawn with one instanced draw call per flush instead of four vertices
+// each through raylib's batch. needs a gl context to load
+typedef struct SpriteBatch {
+    Shader shader;
+    int mvp_location;
+    unsigned int vao;
+    unsigned int corner_buffer; // the quad every sprite is an instance of
+    unsigned int instance_buffer;
+    int buffer_offset; // instance the next flush is written at
+    int instance_locations[4]; // of the per instance attributes
+    SpriteInstance* instances;
+    int count;
+    Texture2D texture; // of the atlas the sprites are from
+} SpriteBatch;
+
+SpriteBatch loadSpriteBatch(void);
+void unloadSpriteBatch(SpriteBatch* batch);
+
+// queued until the next flush, on top of what was queued before
+void batchSprite(SpriteBatch* batch, Atlas* atlas, enum SpriteId sprite, Vector2 position, Color tint);
+// part of a sprite, region is in the sprite's own pixels and position is where the region goes
+void batchSpriteRegion(SpriteBatch* batch, Atlas* atlas, enum SpriteId sprite, Rectangle region, Vector2 position, Color tint);
+// draws the queued sprites with the current raylib transform, after everything raylib has queued
+void flushSpriteBatch(SpriteBatch* batch);
+
+#endif
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace.h"
+#include "profiler.h"
+
+typedef struct TraceEvent {
+    const char* name;
+    double started; // seconds, profilerNow()
+    double ended;
+} TraceEvent;
+
+typedef struct Trace {
+    bool recording;
+    TraceEvent* events;
+    long count; // total recorded, the buffer holds the last TRACE_CAPACITY of them
+} Trace;
+
+static Trace trace;
+
+void traceStart(void) {
+    if (trace.events == NULL) {
+        trace.events = malloc(TRACE_CAPACITY * sizeof(TraceEvent));
+    }
+    trace.count = 0;
+    trace.recording = true;
+}
+
+void traceStop(void) {
+    trace.recording = false;
+}
+
+bool traceRecording(void) {
+    return trace.recording;
+}
+
+double traceBegin(void) {
+    if (!trace.recording) return 0;
+    return profilerNow();
+}
+
+void traceEnd(const char* name, double started) {
+    if (!trace.recording) { return; }
+    traceEvent(name, started, profilerNow());
+}
+
+void traceEvent(const char* name, double started, double ended) {
+    if (!trace.recording) { return; }
+    trace.events[trace.count % TRACE_CAPACITY] = (TraceEvent) {.name=name, .started=started, .ended=ended};
+    trace.count++;
+}
+
+bool traceWrite(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) return false;
+
+    long first = trace.count > TRACE_CAPACITY ? trace.count - TRACE_CAPACITY : 0;
+    // events are recorded when they end, so an enclosing zone can start before the first one
+    double origin = 0;
+    for (long i = first; i < trace.count; i++) {
+        double started = trace.events[i % TRACE_CAPACITY].started;
+        if (i == first || started < origin) {
+            origin = started;
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (long i = first; i < trace.count; i++) {
+        TraceEvent event = trace.events[i % TRACE_CAPACITY];
+        // timestamps are in microseconds
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            event.name,
+            (event.started - origin) * 1e6,
+            (event.ended - event.started) * 1e6,
+            i + 1 < trace.count ? "," : "");
+    }
+    fprintf(file, "]}\n");
+
+    return fclose(file) == 0;
+}
+
+void freeTrace(void) {
+    free(trace.events);
+    trace = (Trace) {0};
+}
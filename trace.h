@@ -0,0 +1,25 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+// events kept while recording, older ones are overwritten
+#define TRACE_CAPACITY (1 << 19)
+
+// records complete events into a ring buffer and writes them out in the
+// trace event format, which perfetto and chrome://tracing can open
+void traceStart(void);
+void traceStop(void);
+bool traceRecording(void);
+
+// start time for traceEnd, 0 when not recording
+double traceBegin(void);
+// name must outlive the recording, string literals are fine
+void traceEnd(const char* name, double started);
+void traceEvent(const char* name, double started, double ended);
+
+// returns false when the file could not be written
+bool traceWrite(const char* path);
+void freeTrace(void);
+
+#endif
@@ -0,0 +1,77 @@
+#include <math.h>
+#include "viewport.h"
+
+// same as GetScreenToWorld2D() for an unrotated camera, without needing raylib
+Rectangle viewportArea(Camera2D camera) {
+    return (Rectangle) {
+        .x = camera.target.x - camera.offset.x / camera.zoom,
+        .y = camera.target.y - camera.offset.y / camera.zoom,
+        .width = screen_width / camera.zoom,
+        .height = screen_height / camera.zoom,
+    };
+}
+
+int maxInt(int a, int b) {
+    return a > b ? a : b;
+}
+
+int minInt(int a, int b) {
+    return a < b ? a : b;
+}
+
+VisibleCells visibleCells(Rectangle area, GameMap* map) {
+    // toIso() puts the sprite of cell (x, y) at ((x - y) * TILE_WIDTH / 2 - TILE_WIDTH / 2, (x + y) * TILE_HEIGHT / 2),
+    // it is TILE_WIDTH square and objects are drawn TILE_HEIGHT above their cell
+    float left = (area.x - screen_width / 2) / (TILE_WIDTH / 2);
+    float right = (area.x + area.width - screen_width / 2) / (TILE_WIDTH / 2);
+    float top = (area.y - VERTICAL_OFFSET) / (TILE_HEIGHT / 2);
+    float bottom = (area.y + area.height - VERTICAL_OFFSET) / (TILE_HEIGHT / 2);
+
+    // one more cell on every side for objects drawn between two ticks
+    VisibleCells visible = {
+        .min_diff = floorf(left) - 2,
+        .max_diff = ceilf(right) + 2,
+        .min_sum = floorf(top) - 2 * TILE_WIDTH / TILE_HEIGHT - 1,
+        .max_sum = ceilf(bottom) + 2 + 1,
+        .width = map->width,
+    };
+    // y = (sum - diff) / 2
+    visible.first_row = maxInt(0, floorf((visible.min_sum - visible.max_diff) / 2.0f));
+    visible.last_row = minInt(map->height - 1, ceilf((visible.max_sum - visible.min_diff) / 2.0f));
+    return visible;
+}
+
+VisibleCells wholeMap(GameMap* map) {
+    return (VisibleCells) {
+        .first_row = 0,
+        .last_row = map->height - 1,
+        .min_diff = -map->height - 1,
+        .max_diff = map->width + 1,
+        .min_sum = -2,
+        .max_sum = map->width + map->height,
+        .width = map->width,
+    };
+}
+
+bool visibleRowSpan(VisibleCells* visible, int y, int* first_x, int* last_x) {
+    if (y < visible->first_row || y > visible->last_row) return false;
+
+    *first_x = maxInt(0, maxInt(visible->min_diff + y, visible->min_sum - y));
+    *last_x = minInt(visible->width - 1, minInt(visible->max_diff + y, visible->max_sum - y));
+    return *first_x <= *last_x;
+}
+
+bool positionVisible(VisibleCells* visible, Vector2 position) {
+    float diff = position.x - position.y;
+    float sum = position.x + position.y;
+    return diff >= visible->min_diff && diff <= visible->max_diff && sum >= visible->min_sum && sum <= visible->max_sum;
+}
+
+bool chunkVisible(VisibleCells* visible, int cx, int cy) {
+    int x = cx * CHUNK_SIZE;
+    int y = cy * CHUNK_SIZE;
+    int last = CHUNK_SIZE - 1;
+    if (y > visible->last_row || y + last < visible->first_row) return false;
+    if (x - (y + last) > visible->max_diff || x + last - y < visible->min_diff) return false;
+    return x + y <= visible->max_sum && x + y + 2 * last >= visible->min_sum;
+}
@@ -0,0 +1,33 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "game.h"
+
+#define CAMERA_MIN_ZOOM 0.5f
+#define CAMERA_MAX_ZOOM 3.0f
+
+// the grid cells whose sprites can reach into the view. a screen rectangle is a band of
+// x - y (screen columns) crossed with a band of x + y (screen rows) on the grid
+typedef struct VisibleCells {
+    int first_row; // y, the rows are empty when last_row < first_row
+    int last_row;
+    int min_diff; // x - y
+    int max_diff;
+    int min_sum; // x + y
+    int max_sum;
+    int width; // of the map
+} VisibleCells;
+
+// the part of the world the camera shows, in toIso() coordinates
+Rectangle viewportArea(Camera2D camera);
+VisibleCells visibleCells(Rectangle area, GameMap* map);
+// every cell of the map, for drawing without a camera
+VisibleCells wholeMap(GameMap* map);
+
+// cells of row y in view, false if there are none
+bool visibleRowSpan(VisibleCells* visible, int y, int* first_x, int* last_x);
+// for objects between cells too
+bool positionVisible(VisibleCells* visible, Vector2 position);
+bool chunkVisible(VisibleCells* visible, int cx, int cy);
+
+#endif
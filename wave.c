@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wave.h"
+
+typedef struct WaveTypeName {
+    const char* name;
+    enum GeneralObjectType type;
+} WaveTypeName;
+
+// the object types a wave can spawn
+const WaveTypeName WAVE_TYPES[] = {
+    {"ENEMY_TYPE_1", ENEMY_TYPE_1},
+    {"ENEMY_TYPE_2", ENEMY_TYPE_2},
+};
+#define WAVE_TYPE_COUNT (sizeof(WAVE_TYPES) / sizeof(WAVE_TYPES[0]))
+
+// ties keep no particular order, spawns that compare equal are identical anyway
+int compareSpawns(const void* a, const void* b) {
+    const WaveSpawn* sa = a;
+    const WaveSpawn* sb = b;
+    if (sa->time != sb->time) return sa->time < sb->time ? -1 : 1;
+    if (sa->row != sb->row) return sa->row - sb->row;
+    return (int) sa->type - (int) sb->type;
+}
+
+void addSpawn(EnemyWave* wave, int* capacity, WaveSpawn spawn) {
+    if (wave->count >= *capacity) {
+        *capacity = *capacity == 0 ? 64 : *capacity * 2;
+        wave->spawns = realloc(wave->spawns, *capacity * sizeof(WaveSpawn));
+    }
+    wave->spawns[wave->count++] = spawn;
+}
+
+bool loadWave(EnemyWave* wave, const char* path) {
+    *wave = (EnemyWave) {0};
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "wave: could not open %s\n", path);
+        return false;
+    }
+
+    int capacity = 0;
+    char line[256];
+    for (int line_number = 1; fgets(line, sizeof(line), file) != NULL; line_number++) {
+        char* comment = strchr(line, '#');
+        if (comment != NULL) { *comment = '\0'; }
+
+        char blank[2];
+        if (sscanf(line, " %1s", blank) != 1) { continue; }
+
+        double time, interval;
+        int row, count;
+        char type_name[32];
+        int type = -1;
+        if (sscanf(line, "%lf %d %31s %d %lf", &time, &row, type_name, &count, &interval) == 5) {
+            for (size_t t = 0; t < WAVE_TYPE_COUNT; t++) {
+                if (strcmp(type_name, WAVE_TYPES[t].name) == 0) { type = WAVE_TYPES[t].type; }
+            }
+        }
+
+        if (type == -1 || time < 0 || row < 0 || count < 1 || interval < 0) {
+            fprintf(stderr, "wave: %s:%d: expected \"time row type count interval\"\n", path, line_number);
+            fclose(file);
+            freeWave(wave);
+            return false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            addSpawn(wave, &capacity, (WaveSpawn) {.time=time + i * interval, .row=row, .type=type});
+        }
+    }
+    fclose(file);
+
+    // lines may overlap in time, the spawner needs a single timeline
+    qsort(wave->spawns, wave->count, sizeof(WaveSpawn), compareSpawns);
+    return true;
+}
+
+void freeWave(EnemyWave* wave) {
+    free(wave->spawns);
+    *wave = (EnemyWave) {0};
+}
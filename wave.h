@@ -0,0 +1,13 @@
+#ifndef WAVE_H
+#define WAVE_H
+
+#include <stdbool.h>
+#include "game.h"
+
+// reads a wave file, lines of "time row type count interval" and # comments,
+// e.g. "2.5 9 ENEMY_TYPE_1 20 0.5" spawns 20 enemies on row 9, from 2.5s on, half a second apart.
+// the spawns end up ordered by time. returns false and reports the line on errors
+bool loadWave(EnemyWave* wave, const char* path);
+void freeWave(EnemyWave* wave);
+
+#endif